@@ -5,6 +5,75 @@
 namespace QtSignalTools
 {
 
+#ifdef QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
+// placeholder type for the argN_type typedefs and arg<N>::type
+// of arguments beyond a function's argument count
+struct NoArg {};
+
+// yields the Nth type in Args, or NoArg if N is out of range
+template <int N, class... Args>
+struct ArgAt
+{
+	typedef NoArg type;
+};
+
+template <class T, class... Args>
+struct ArgAt<0, T, Args...>
+{
+	typedef T type;
+};
+
+template <int N, class T, class... Args>
+struct ArgAt<N, T, Args...>
+{
+	typedef typename ArgAt<N-1, Args...>::type type;
+};
+
+// extract the argument count and types
+// from a function signature
+template <class T>
+struct FunctionTraits;
+
+template <class R, class... Args>
+struct FunctionTraits<R(Args...)>
+{
+	enum { count = sizeof...(Args) };
+	typedef R result_type;
+
+	template <int N>
+	struct arg
+	{
+		typedef typename ArgAt<N, Args...>::type type;
+	};
+
+	// typedefs matching the fixed-arity traits used in C++03 builds
+	typedef typename arg<0>::type arg0_type;
+	typedef typename arg<1>::type arg1_type;
+	typedef typename arg<2>::type arg2_type;
+	typedef typename arg<3>::type arg3_type;
+	typedef typename arg<4>::type arg4_type;
+};
+
+#ifdef __cpp_noexcept_function_type
+template <class R, class... Args>
+struct FunctionTraits<R(Args...) noexcept> : FunctionTraits<R(Args...)>
+{};
+#endif
+
+// index sequence used to expand an argument array into
+// a call with one argument per element
+template <int... Indexes>
+struct IndexList {};
+
+template <int N, int... Indexes>
+struct MakeIndexList : MakeIndexList<N-1, N-1, Indexes...> {};
+
+template <int... Indexes>
+struct MakeIndexList<0, Indexes...>
+{
+	typedef IndexList<Indexes...> type;
+};
+#else
 // extract the argument count and types
 // from a function signature
 template <class T>
@@ -51,13 +120,43 @@ struct FunctionTraits<R(T1,T2,T3,T4,T5)> : FunctionTraits<R(T1,T2,T3,T4)>
 	enum { count = 5 };
 	typedef T5 arg4_type;
 };
+#endif
+
+#ifdef QST_COMPILER_SUPPORTS_DECLTYPE
+template <class T>
+struct ExtractSignature;
+
+template <class T>
+struct VoidType
+{
+	typedef void type;
+};
+
+// extract the signature of a lambda or other function object with
+// a single, non-template operator()
+template <class T, class Enable = void>
+struct ExtractCallOperatorSignature
+{
+	typedef T type;
+};
+
+template <class T>
+struct ExtractCallOperatorSignature<T, typename VoidType<decltype(&T::operator())>::type>
+{
+	typedef typename ExtractSignature<decltype(&T::operator())>::type type;
+};
+#endif
 
 // extract the function signature from an input type T,
 // where T may be a function pointer or function object
 template <class T>
 struct ExtractSignature
 {
+#ifdef QST_COMPILER_SUPPORTS_DECLTYPE
+	typedef typename ExtractCallOperatorSignature<T>::type type;
+#else
 	typedef T type;
+#endif
 };
 
 template <class T>
@@ -78,6 +177,74 @@ struct ExtractSignature<Signature Class::*>
 	typedef Signature type;
 };
 
+#ifdef QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
+// member function pointers and noexcept functions map to the plain
+// signature R(Args...), excluding the class and qualifiers
+template <class R, class Class, class... Args>
+struct ExtractSignature<R (Class::*)(Args...)>
+{
+	typedef R type(Args...);
+};
+
+template <class R, class Class, class... Args>
+struct ExtractSignature<R (Class::*)(Args...) const>
+{
+	typedef R type(Args...);
+};
+
+#ifdef __cpp_noexcept_function_type
+template <class R, class... Args>
+struct ExtractSignature<R (*)(Args...) noexcept>
+{
+	typedef R type(Args...);
+};
+
+template <class R, class Class, class... Args>
+struct ExtractSignature<R (Class::*)(Args...) noexcept>
+{
+	typedef R type(Args...);
+};
+
+template <class R, class Class, class... Args>
+struct ExtractSignature<R (Class::*)(Args...) const noexcept>
+{
+	typedef R type(Args...);
+};
+#endif
+#endif
+
+#ifdef QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
+// extract the result type from a member function pointer.  This
+// avoids mem_fn()'s result_type, which was removed in C++20
+template <class MemberFunc>
+struct MemberFuncResultType;
+
+template <class R, class Class, class... Args>
+struct MemberFuncResultType<R (Class::*)(Args...)>
+{
+	typedef R type;
+};
+
+template <class R, class Class, class... Args>
+struct MemberFuncResultType<R (Class::*)(Args...) const>
+{
+	typedef R type;
+};
+
+#ifdef __cpp_noexcept_function_type
+template <class R, class Class, class... Args>
+struct MemberFuncResultType<R (Class::*)(Args...) noexcept>
+{
+	typedef R type;
+};
+
+template <class R, class Class, class... Args>
+struct MemberFuncResultType<R (Class::*)(Args...) const noexcept>
+{
+	typedef R type;
+};
+#endif
+#else
 template <class MemberFunc>
 struct MemberFuncResultType
 {
@@ -88,6 +255,7 @@ struct MemberFuncResultType
 #endif
 	typedef typename MemFnType::result_type type;
 };
+#endif
 
 }
 
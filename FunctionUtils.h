@@ -14,18 +14,30 @@
 #if (_MSC_VER >= 1600)
 #define QST_COMPILER_SUPPORTS_LAMBDAS
 #define QST_COMPILER_SUPPORTS_DECLTYPE
+#define QST_COMPILER_SUPPORTS_RVALUE_REFERENCES
+#endif
+#if (_MSC_VER >= 1800)
+#define QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
+#endif
+#if (_MSC_VER >= 1900)
+#define QST_COMPILER_SUPPORTS_NOEXCEPT
 #endif
 
 // GCC
 // See http://gcc.gnu.org/projects/cxx0x.html
-#if (__GNUC__ >= 4) && defined(__GXX_EXPERIMENTAL_CXX0X__)
-#if (__GNUC_MINOR__ >= 3)
+#if defined(__GNUC__) && defined(__GXX_EXPERIMENTAL_CXX0X__)
+#define QST_GCC_VERSION (__GNUC__ * 100 + __GNUC_MINOR__)
+#if (QST_GCC_VERSION >= 403)
 #define QST_COMPILER_SUPPORTS_DECLTYPE
 #define QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
+#define QST_COMPILER_SUPPORTS_RVALUE_REFERENCES
 #endif
-#if (__GNUC_MINOR__ >= 5)
+#if (QST_GCC_VERSION >= 405)
 #define QST_COMPILER_SUPPORTS_LAMBDAS
 #endif
+#if (QST_GCC_VERSION >= 406)
+#define QST_COMPILER_SUPPORTS_NOEXCEPT
+#endif
 #endif
 
 // Clang
@@ -38,6 +50,36 @@
 #if __has_feature(cxx_variadic_templates)
 #define QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
 #endif
+#if __has_feature(cxx_rvalue_references)
+#define QST_COMPILER_SUPPORTS_RVALUE_REFERENCES
+#endif
+#if __has_feature(cxx_noexcept)
+#define QST_COMPILER_SUPPORTS_NOEXCEPT
+#endif
+#endif
+
+// a function declared with QST_NOEXCEPT_IF(expr) is noexcept if
+// expr is true and the compiler supports noexcept specifications
+#ifdef QST_COMPILER_SUPPORTS_NOEXCEPT
+#define QST_NOEXCEPT_IF(expr) noexcept(expr)
+#else
+#define QST_NOEXCEPT_IF(expr)
+#endif
+
+// storage class for plain-old-data variables with one instance per thread.
+// Left undefined for compilers which do not support it.
+#if defined(_MSC_VER)
+#define QST_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define QST_THREAD_LOCAL __thread
+#endif
+
+// C++20 coroutines
+// See https://en.cppreference.com/w/cpp/feature_test
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define QST_COMPILER_SUPPORTS_COROUTINES
+#endif
 #endif
 
 #ifdef QST_COMPILER_SUPPORTS_LAMBDAS
@@ -52,6 +94,7 @@
 #include <functional>
 #include <memory>
 #include <type_traits>
+#include <utility>
 
 #ifndef _MSC_VER
 // even under C++11, we are still using the TR1 version
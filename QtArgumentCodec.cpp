@@ -0,0 +1,401 @@
+#include "QtArgumentCodec.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include <string.h>
+
+// Encoded forms:
+//
+//  - PODs are stored as their raw bytes
+//  - QString is stored as a quint32 length in UTF-16 code units followed by the
+//    UTF-16 data.  A null string has a length of 0xffffffff.
+//  - QByteArray is stored in the same way, with the length in bytes
+//  - Containers are stored as a quint32 count followed by the elements
+//  - Other types are stored as a quint32 size followed by the output
+//    of QMetaType::save()
+
+struct QtArgumentCodec::Reader
+{
+	Reader(const char* _data, int _size, int _offset)
+		: data(_data)
+		, size(_size)
+		, offset(_offset)
+	{}
+
+	int remaining() const
+	{
+		return size - offset;
+	}
+
+	bool read(void* dest, int count)
+	{
+		if (count > remaining()) {
+			return false;
+		}
+		memcpy(dest, data + offset, count);
+		offset += count;
+		return true;
+	}
+
+	const char* data;
+	int size;
+	int offset;
+};
+
+namespace
+{
+
+typedef QtArgumentCodec::Reader Reader;
+
+const quint32 NULL_LENGTH = 0xffffffff;
+const QDataStream::Version STREAM_VERSION = QDataStream::Qt_4_6;
+
+void writeLength(QByteArray* buffer, quint32 length)
+{
+	buffer->append(reinterpret_cast<const char*>(&length), sizeof(length));
+}
+
+bool readLength(Reader* reader, quint32* length)
+{
+	return reader->read(length, sizeof(*length));
+}
+
+template <class T>
+void writeElement(QByteArray* buffer, const T& value)
+{
+	buffer->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void writeElement(QByteArray* buffer, const QString& value)
+{
+	if (value.isNull()) {
+		writeLength(buffer, NULL_LENGTH);
+		return;
+	}
+	writeLength(buffer, value.length());
+	buffer->append(reinterpret_cast<const char*>(value.constData()), value.length() * sizeof(QChar));
+}
+
+void writeElement(QByteArray* buffer, const QByteArray& value)
+{
+	if (value.isNull()) {
+		writeLength(buffer, NULL_LENGTH);
+		return;
+	}
+	writeLength(buffer, value.size());
+	buffer->append(value.constData(), value.size());
+}
+
+template <class T>
+bool readElement(Reader* reader, T* value)
+{
+	return reader->read(value, sizeof(T));
+}
+
+bool readElement(Reader* reader, QString* value)
+{
+	quint32 length;
+	if (!readLength(reader, &length)) {
+		return false;
+	}
+	if (length == NULL_LENGTH) {
+		*value = QString();
+		return true;
+	}
+	if (length > quint32(reader->remaining()) / sizeof(QChar)) {
+		return false;
+	}
+	value->resize(length);
+	return reader->read(value->data(), length * sizeof(QChar));
+}
+
+bool readElement(Reader* reader, QByteArray* value)
+{
+	quint32 length;
+	if (!readLength(reader, &length)) {
+		return false;
+	}
+	if (length == NULL_LENGTH) {
+		*value = QByteArray();
+		return true;
+	}
+	if (length > quint32(reader->remaining())) {
+		return false;
+	}
+	*value = QByteArray(reader->data + reader->offset, length);
+	reader->offset += length;
+	return true;
+}
+
+template <class T>
+bool encodeSingle(QByteArray* buffer, int, const void* value)
+{
+	writeElement(buffer, *static_cast<const T*>(value));
+	return true;
+}
+
+template <class T>
+bool decodeSingle(Reader* reader, int, void* value)
+{
+	return readElement(reader, static_cast<T*>(value));
+}
+
+template <class Container>
+bool encodeContainer(QByteArray* buffer, int, const void* value)
+{
+	const Container& container = *static_cast<const Container*>(value);
+	writeLength(buffer, container.count());
+	for (int i=0; i < container.count(); i++) {
+		writeElement(buffer, container.at(i));
+	}
+	return true;
+}
+
+template <class Container>
+bool decodeContainer(Reader* reader, int, void* value)
+{
+	Container& container = *static_cast<Container*>(value);
+	container.clear();
+	quint32 count;
+	if (!readLength(reader, &count)) {
+		return false;
+	}
+	// each element occupies at least one byte, so this rejects
+	// counts in corrupt data before allocating anything
+	if (count > quint32(reader->remaining())) {
+		return false;
+	}
+	for (quint32 i=0; i < count; i++) {
+		typename Container::value_type element;
+		if (!readElement(reader, &element)) {
+			return false;
+		}
+		container.append(element);
+	}
+	return true;
+}
+
+template <class T>
+bool encodePodVector(QByteArray* buffer, int, const void* value)
+{
+	const QVector<T>& vector = *static_cast<const QVector<T>*>(value);
+	writeLength(buffer, vector.count());
+	buffer->append(reinterpret_cast<const char*>(vector.constData()), vector.count() * sizeof(T));
+	return true;
+}
+
+template <class T>
+bool decodePodVector(Reader* reader, int, void* value)
+{
+	QVector<T>& vector = *static_cast<QVector<T>*>(value);
+	quint32 count;
+	if (!readLength(reader, &count) || count > quint32(reader->remaining()) / sizeof(T)) {
+		return false;
+	}
+	vector.resize(count);
+	return reader->read(vector.data(), count * sizeof(T));
+}
+
+bool encodeStream(QByteArray* buffer, int typeId, const void* value)
+{
+	int lengthOffset = buffer->size();
+	writeLength(buffer, 0);
+	{
+		QDataStream stream(buffer, QIODevice::WriteOnly | QIODevice::Append);
+		stream.setVersion(STREAM_VERSION);
+		if (!QMetaType::save(stream, typeId, value)) {
+			return false;
+		}
+	}
+	quint32 length = buffer->size() - lengthOffset - sizeof(quint32);
+	memcpy(buffer->data() + lengthOffset, &length, sizeof(length));
+	return true;
+}
+
+bool decodeStream(Reader* reader, int typeId, void* value)
+{
+	quint32 length;
+	if (!readLength(reader, &length) || length > quint32(reader->remaining())) {
+		return false;
+	}
+	QDataStream stream(QByteArray::fromRawData(reader->data + reader->offset, length));
+	stream.setVersion(STREAM_VERSION);
+	reader->offset += length;
+	return QMetaType::load(stream, typeId, value);
+}
+
+struct CodecFuncs
+{
+	QtArgumentCodec::EncodeFunc encode;
+	QtArgumentCodec::DecodeFunc decode;
+};
+
+template <class T>
+CodecFuncs singleFuncs()
+{
+	CodecFuncs funcs = { encodeSingle<T>, decodeSingle<T> };
+	return funcs;
+}
+
+template <class Container>
+CodecFuncs containerFuncs()
+{
+	CodecFuncs funcs = { encodeContainer<Container>, decodeContainer<Container> };
+	return funcs;
+}
+
+CodecFuncs findCodecFuncs(int typeId)
+{
+	switch (typeId) {
+	case QMetaType::Bool:
+		return singleFuncs<bool>();
+	case QMetaType::Char:
+		return singleFuncs<char>();
+	case QMetaType::UChar:
+		return singleFuncs<uchar>();
+	case QMetaType::Short:
+		return singleFuncs<short>();
+	case QMetaType::UShort:
+		return singleFuncs<ushort>();
+	case QMetaType::Int:
+		return singleFuncs<int>();
+	case QMetaType::UInt:
+		return singleFuncs<uint>();
+	case QMetaType::Long:
+		return singleFuncs<long>();
+	case QMetaType::ULong:
+		return singleFuncs<ulong>();
+	case QMetaType::LongLong:
+		return singleFuncs<qlonglong>();
+	case QMetaType::ULongLong:
+		return singleFuncs<qulonglong>();
+	case QMetaType::Float:
+		return singleFuncs<float>();
+	case QMetaType::Double:
+		return singleFuncs<double>();
+	case QMetaType::QChar:
+		return singleFuncs<QChar>();
+	case QMetaType::QString:
+		return singleFuncs<QString>();
+	case QMetaType::QByteArray:
+		return singleFuncs<QByteArray>();
+	case QMetaType::QStringList:
+		return containerFuncs<QStringList>();
+	default:
+		break;
+	}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	// container types are registered automatically by Qt 5
+	if (typeId == qMetaTypeId<QVector<int> >()) {
+		CodecFuncs funcs = { encodePodVector<int>, decodePodVector<int> };
+		return funcs;
+	} else if (typeId == qMetaTypeId<QVector<double> >()) {
+		CodecFuncs funcs = { encodePodVector<double>, decodePodVector<double> };
+		return funcs;
+	} else if (typeId == qMetaTypeId<QList<int> >()) {
+		return containerFuncs<QList<int> >();
+	} else if (typeId == qMetaTypeId<QList<double> >()) {
+		return containerFuncs<QList<double> >();
+	} else if (typeId == qMetaTypeId<QList<QByteArray> >()) {
+		return containerFuncs<QList<QByteArray> >();
+	}
+#endif
+
+	CodecFuncs funcs = { encodeStream, decodeStream };
+	return funcs;
+}
+
+}
+
+QtArgumentCodec::QtArgumentCodec()
+	: m_direct(true)
+{
+}
+
+QtArgumentCodec::QtArgumentCodec(const QList<int>& typeIds)
+	: m_direct(true)
+{
+	Q_FOREACH(int typeId, typeIds) {
+		CodecFuncs funcs = findCodecFuncs(typeId);
+		Arg arg;
+		arg.typeId = typeId;
+		arg.encode = funcs.encode;
+		arg.decode = funcs.decode;
+		m_args << arg;
+		if (funcs.encode == encodeStream) {
+			m_direct = false;
+		}
+	}
+}
+
+QList<int> QtArgumentCodec::typeIds() const
+{
+	QList<int> ids;
+	Q_FOREACH(const Arg& arg, m_args) {
+		ids << arg.typeId;
+	}
+	return ids;
+}
+
+bool QtArgumentCodec::isDirect() const
+{
+	return m_direct;
+}
+
+bool QtArgumentCodec::encode(QByteArray* buffer, const QGenericArgument* args, int count) const
+{
+	int initialSize = buffer->size();
+	int argCount = qMin(count, m_args.count());
+	for (int i=0; i < argCount; i++) {
+		const Arg& arg = m_args.at(i);
+		if (!arg.encode(buffer, arg.typeId, args[i].data())) {
+			buffer->truncate(initialSize);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool QtArgumentCodec::decode(const char* data, int size, int* offset, QVariant* values) const
+{
+	Reader reader(data, size, *offset);
+	for (int i=0; i < m_args.count(); i++) {
+		const Arg& arg = m_args.at(i);
+		if (values[i].userType() != arg.typeId) {
+			values[i] = QVariant(arg.typeId, static_cast<const void*>(0));
+		}
+		if (!arg.decode(&reader, arg.typeId, values[i].data())) {
+			return false;
+		}
+	}
+	*offset = reader.offset;
+	return true;
+}
+
+bool QtArgumentCodec::encodeValue(QByteArray* buffer, int typeId, const void* value)
+{
+	int initialSize = buffer->size();
+	if (!findCodecFuncs(typeId).encode(buffer, typeId, value)) {
+		buffer->truncate(initialSize);
+		return false;
+	}
+	return true;
+}
+
+bool QtArgumentCodec::decodeValue(const char* data, int size, int* offset, int typeId, void* value)
+{
+	Reader reader(data, size, *offset);
+	if (!findCodecFuncs(typeId).decode(&reader, typeId, value)) {
+		return false;
+	}
+	*offset = reader.offset;
+	return true;
+}
+
+bool QtArgumentCodec::hasFastPath(int typeId)
+{
+	return findCodecFuncs(typeId).encode != encodeStream;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "QtMetacallAdapter.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QVariant>
+
+/** QtArgumentCodec serializes signal arguments to a compact binary form, for
+ * moving them to disk or to another process, and reads them back.
+ *
+ * A codec is created for a list of meta-type IDs, as used by QtSignalForwarder
+ * when checking that a signal's arguments match a callback.  The function used
+ * to encode and decode each argument is chosen once, when the codec is created.
+ *
+ * Arguments of the following types are written directly, without going through
+ * QDataStream:
+ *
+ *  - bool, integer and floating-point types and QChar
+ *  - QString and QByteArray
+ *  - QStringList and, with Qt 5, QList and QVector of int and double and QList<QByteArray>
+ *
+ * Other types are serialized with QMetaType::save() and QMetaType::load(),
+ * which requires them to be registered with qRegisterMetaTypeStreamOperators<T>().
+ *
+ * Values are stored in the byte order of the machine which encoded them.
+ *
+ * Many argument tuples can be encoded into the same buffer by calling encode() repeatedly.
+ * With Qt 5, a buffer whose capacity was set with QByteArray::reserve() keeps it when
+ * resized to zero, so reusing it for successive batches avoids reallocating it.
+ *
+ * Example usage:
+ *
+ *  QList<int> typeIds;
+ *  typeIds << QMetaType::Int << QMetaType::QString;
+ *  QtArgumentCodec codec(typeIds);
+ *
+ *  QByteArray buffer;
+ *  int id = 42;
+ *  QString name("answer");
+ *  QGenericArgument args[] = { Q_ARG(int, id), Q_ARG(QString, name) };
+ *  codec.encode(&buffer, args, 2);
+ *
+ *  int offset = 0;
+ *  QVariant values[2];
+ *  while (offset < buffer.size() && codec.decode(buffer.constData(), buffer.size(), &offset, values)) {
+ *    ...
+ *  }
+ */
+class QtArgumentCodec
+{
+	public:
+		QtArgumentCodec();
+		explicit QtArgumentCodec(const QList<int>& typeIds);
+
+		/** Returns the meta-type IDs of the arguments which the codec reads and writes */
+		QList<int> typeIds() const;
+
+		/** Returns true if all of the codec's argument types have a fast path */
+		bool isDirect() const;
+
+		/** Appends the encoded values of @p count arguments from @p args to @p buffer.
+		 * If @p count is less than the number of types, the remaining values are not
+		 * written and must not be decoded.
+		 *
+		 * Returns false and leaves @p buffer unchanged if an argument could not be serialized.
+		 */
+		bool encode(QByteArray* buffer, const QGenericArgument* args, int count) const;
+
+		/** Decodes one tuple of arguments, starting at @p *offset in @p data, into @p values,
+		 * which must have room for typeIds().count() entries.  On success, @p *offset is
+		 * advanced past the tuple.
+		 *
+		 * Returns false if the data is truncated or could not be deserialized.
+		 */
+		bool decode(const char* data, int size, int* offset, QVariant* values) const;
+
+		/** Appends the encoded form of @p value, which is of type @p typeId, to @p buffer */
+		static bool encodeValue(QByteArray* buffer, int typeId, const void* value);
+
+		/** Decodes a value of type @p typeId starting at @p *offset in @p data into @p value,
+		 * which must point to a constructed instance of the type.
+		 */
+		static bool decodeValue(const char* data, int size, int* offset, int typeId, void* value);
+
+		/** Returns true if values of type @p typeId are serialized
+		 * without going through QDataStream.
+		 */
+		static bool hasFastPath(int typeId);
+
+		struct Reader;
+		typedef bool (*EncodeFunc)(QByteArray* buffer, int typeId, const void* value);
+		typedef bool (*DecodeFunc)(Reader* reader, int typeId, void* value);
+
+	private:
+		struct Arg
+		{
+			int typeId;
+			EncodeFunc encode;
+			DecodeFunc decode;
+		};
+
+		QList<Arg> m_args;
+		bool m_direct;
+};
+
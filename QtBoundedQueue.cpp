@@ -0,0 +1,228 @@
+#include "QtBoundedQueue.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+
+// adapter which adds calls to a QtBoundedQueue instead
+// of invoking the queue's callback directly
+struct QtBoundedQueueImpl : public QtSignalTools::QtMetacallAdapterImplIface
+{
+	QtBoundedQueue* queue;
+	QtMetacallAdapter callback;
+
+	QtBoundedQueueImpl(QtBoundedQueue* _queue, const QtMetacallAdapter& _callback)
+	: queue(_queue)
+	, callback(_callback)
+	{}
+
+	virtual bool invoke(const QGenericArgument* args, int count) const {
+		return queue->enqueue(args, count);
+	}
+
+	virtual int getArgTypes(QtMetacallArgsArray args) const {
+		return callback.getArgTypes(args);
+	}
+};
+
+QtBoundedQueue::QtBoundedQueue(const QtMetacallAdapter& callback, int capacity, OverflowPolicy policy,
+	QObject* parent)
+	: QObject(parent)
+	, m_callback(callback)
+	, m_capacity(qMax(capacity, 1))
+	, m_policy(policy)
+	, m_keyArgument(0)
+	, m_headSequence(0)
+	, m_deliveryPosted(false)
+	, m_droppedCount(0)
+	, m_enqueuedCount(0)
+	, m_deliveredCount(0)
+{
+	m_argCount = m_callback.getArgTypes(m_argTypes);
+}
+
+QtBoundedQueue::~QtBoundedQueue()
+{
+}
+
+int QtBoundedQueue::capacity() const
+{
+	return m_capacity;
+}
+
+QtBoundedQueue::OverflowPolicy QtBoundedQueue::policy() const
+{
+	return m_policy;
+}
+
+void QtBoundedQueue::setKeyArgument(int index)
+{
+	Q_ASSERT_X(index >= 0 && index < m_argCount, Q_FUNC_INFO, "Key argument index is out of range");
+	QMutexLocker lock(&m_mutex);
+	m_keyArgument = index;
+}
+
+int QtBoundedQueue::keyArgument() const
+{
+	QMutexLocker lock(&m_mutex);
+	return m_keyArgument;
+}
+
+QtMetacallAdapter QtBoundedQueue::adapter()
+{
+	return QtMetacallAdapter::fromImpl(new QtBoundedQueueImpl(this, m_callback));
+}
+
+QEvent::Type QtBoundedQueue::deliveryEventType()
+{
+	static int eventType = QEvent::registerEventType();
+	return static_cast<QEvent::Type>(eventType);
+}
+
+QString QtBoundedQueue::keyFor(const PendingCall& call) const
+{
+	return call.args.value(m_keyArgument).toString();
+}
+
+void QtBoundedQueue::dropOldest()
+{
+	PendingCall oldest = m_pending.takeFirst();
+	if (m_policy == KeepLatestPerKey) {
+		m_keySequences.remove(oldest.key);
+	}
+	++m_headSequence;
+	++m_droppedCount;
+}
+
+bool QtBoundedQueue::enqueue(const QGenericArgument* args, int count)
+{
+	if (count < m_argCount) {
+		qWarning() << "Unable to queue call.  Expected" << m_argCount << "arguments but received" << count;
+		return false;
+	}
+
+	// copy the arguments before taking the lock
+	PendingCall call;
+	for (int i=0; i < m_argCount; i++) {
+		call.args << QVariant(m_argTypes[i], args[i].data());
+	}
+
+	QMutexLocker lock(&m_mutex);
+
+	if (m_policy == KeepLatestPerKey) {
+		call.key = keyFor(call);
+		QHash<QString,qint64>::const_iterator iter = m_keySequences.constFind(call.key);
+		if (iter != m_keySequences.constEnd()) {
+			m_pending[static_cast<int>(*iter - m_headSequence)] = call;
+			++m_droppedCount;
+			++m_enqueuedCount;
+			return true;
+		}
+	}
+
+	if (m_pending.count() >= m_capacity) {
+		switch (m_policy) {
+		case BlockProducer:
+			if (QThread::currentThread() == thread()) {
+				// waiting here would deadlock, so deliver the
+				// pending calls instead
+				lock.unlock();
+				flush();
+				lock.relock();
+			} else {
+				while (m_pending.count() >= m_capacity) {
+					m_notFull.wait(&m_mutex);
+				}
+			}
+			break;
+		case DropOldest:
+		case KeepLatestPerKey:
+			dropOldest();
+			break;
+		case DropNewest:
+			++m_droppedCount;
+			return false;
+		}
+	}
+
+	m_pending << call;
+	if (m_policy == KeepLatestPerKey) {
+		m_keySequences.insert(call.key, m_headSequence + m_pending.count() - 1);
+	}
+	++m_enqueuedCount;
+
+	if (!m_deliveryPosted) {
+		m_deliveryPosted = true;
+		QCoreApplication::postEvent(this, new QEvent(deliveryEventType()));
+	}
+	return true;
+}
+
+void QtBoundedQueue::flush()
+{
+	Q_ASSERT_X(QThread::currentThread() == thread(), Q_FUNC_INFO, "flush() called from the wrong thread");
+
+	QList<PendingCall> calls;
+	{
+		QMutexLocker lock(&m_mutex);
+		calls = m_pending;
+		m_pending.clear();
+		m_keySequences.clear();
+		m_headSequence += calls.count();
+		m_deliveryPosted = false;
+		m_notFull.wakeAll();
+	}
+
+	QGenericArgument args[QTMETACALL_MAX_ARGS];
+	Q_FOREACH(const PendingCall& call, calls) {
+		for (int i=0; i < m_argCount; i++) {
+			args[i] = QGenericArgument(QMetaType::typeName(m_argTypes[i]), call.args.at(i).constData());
+		}
+		m_callback.invoke(args, m_argCount);
+	}
+
+	QMutexLocker lock(&m_mutex);
+	m_deliveredCount += calls.count();
+}
+
+bool QtBoundedQueue::event(QEvent* event)
+{
+	if (event->type() == deliveryEventType()) {
+		flush();
+		return true;
+	}
+	return QObject::event(event);
+}
+
+int QtBoundedQueue::pendingCount() const
+{
+	QMutexLocker lock(&m_mutex);
+	return m_pending.count();
+}
+
+quint64 QtBoundedQueue::droppedCount() const
+{
+	QMutexLocker lock(&m_mutex);
+	return m_droppedCount;
+}
+
+quint64 QtBoundedQueue::enqueuedCount() const
+{
+	QMutexLocker lock(&m_mutex);
+	return m_enqueuedCount;
+}
+
+quint64 QtBoundedQueue::deliveredCount() const
+{
+	QMutexLocker lock(&m_mutex);
+	return m_deliveredCount;
+}
+
+void QtBoundedQueue::resetCounters()
+{
+	QMutexLocker lock(&m_mutex);
+	m_droppedCount = 0;
+	m_enqueuedCount = 0;
+	m_deliveredCount = 0;
+}
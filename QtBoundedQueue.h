@@ -0,0 +1,146 @@
+#pragma once
+
+#include "QtMetacallAdapter.h"
+
+#include <QtCore/QEvent>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QVariant>
+#include <QtCore/QWaitCondition>
+
+/** QtBoundedQueue delivers calls to a callback asynchronously via the event loop
+ * of the thread which the queue lives in, holding at most a fixed number of
+ * pending calls.
+ *
+ * QtSignalForwarder invokes callbacks directly in the thread that emitted the signal.
+ * If the callback is a QtCallback whose receiver lives in another thread, the call is
+ * posted to the receiver's event queue and there is no limit on how many calls can
+ * be waiting.  A producer which emits faster than the receiver can keep up will
+ * grow the receiver's event queue without bound.
+ *
+ * QtBoundedQueue provides a bounded alternative.  When the queue is full, the
+ * queue's OverflowPolicy decides whether the producer waits or which call is discarded.
+ * The number of discarded calls is available from droppedCount().
+ *
+ * Example usage, delivering samples from a worker thread to a chart in the GUI
+ * thread and discarding the oldest samples if the chart falls behind:
+ *
+ *  QtBoundedQueue* queue = new QtBoundedQueue(QtCallback(chart, SLOT(addSample(double))),
+ *    1000, QtBoundedQueue::DropOldest, chart);
+ *  QtSignalForwarder::connect(sensor, SIGNAL(sampleReady(double)), queue, queue->adapter());
+ *
+ * The queue should be used as the context object when connecting the adapter, so that
+ * the binding is removed when the queue is destroyed.  The queue must not be destroyed
+ * while a producer is blocked in enqueue().
+ */
+class QtBoundedQueue : public QObject
+{
+	// no Q_OBJECT macro here - delivery uses a custom event type
+	// handled in event()
+
+	public:
+		enum OverflowPolicy
+		{
+			/** Block the producing thread until the receiver has taken the pending
+			 * calls.  If the producer is the thread that the queue lives in, the pending
+			 * calls are delivered immediately instead.
+			 */
+			BlockProducer,
+			/** Discard the oldest pending call to make room for the new one. */
+			DropOldest,
+			/** Discard the new call. */
+			DropNewest,
+			/** Replace any pending call with the same key (see setKeyArgument()) with
+			 * the new call.  If there is no such call and the queue is full, the oldest
+			 * pending call is discarded.
+			 */
+			KeepLatestPerKey
+		};
+
+		QtBoundedQueue(const QtMetacallAdapter& callback, int capacity, OverflowPolicy policy,
+			QObject* parent = 0);
+		virtual ~QtBoundedQueue();
+
+		int capacity() const;
+		OverflowPolicy policy() const;
+
+		/** Sets the index of the argument which is used as the key for the
+		 * KeepLatestPerKey policy.  The argument's type must be convertible
+		 * to a QString using QVariant::toString().  Defaults to 0.
+		 */
+		void setKeyArgument(int index);
+		int keyArgument() const;
+
+		/** Returns an adapter which takes the same arguments as the queue's
+		 * callback and adds a call to the queue when invoked.  This can be passed
+		 * to QtSignalForwarder::connect().
+		 */
+		QtMetacallAdapter adapter();
+
+		/** Adds a call with arguments @p args to the queue.  This may be called
+		 * from any thread.  Returns false if the new call was discarded.
+		 */
+		bool enqueue(const QGenericArgument* args, int count);
+
+		/** Invokes all pending calls immediately.  This must be called from
+		 * the thread that the queue lives in.
+		 */
+		void flush();
+
+		/** Returns the number of calls waiting to be delivered. */
+		int pendingCount() const;
+
+		/** Returns the number of calls which have been discarded because
+		 * the queue was full or the call was replaced by a newer call with the same key.
+		 */
+		quint64 droppedCount() const;
+
+		/** Returns the number of calls which have been added to the queue. */
+		quint64 enqueuedCount() const;
+
+		/** Returns the number of calls which have been delivered to the callback. */
+		quint64 deliveredCount() const;
+
+		/** Resets the dropped, enqueued and delivered counters to zero. */
+		void resetCounters();
+
+		// re-implemented from QObject
+		virtual bool event(QEvent* event);
+
+	private:
+		struct PendingCall
+		{
+			QList<QVariant> args;
+			QString key;
+		};
+
+		static QEvent::Type deliveryEventType();
+
+		QString keyFor(const PendingCall& call) const;
+		void dropOldest();
+
+		QtMetacallAdapter m_callback;
+		QtMetacallArgsArray m_argTypes;
+		int m_argCount;
+		int m_capacity;
+		OverflowPolicy m_policy;
+		int m_keyArgument;
+
+		mutable QMutex m_mutex;
+		QWaitCondition m_notFull;
+		QList<PendingCall> m_pending;
+
+		// sequence number of the call at the head of m_pending and
+		// map of key -> sequence number of pending call, for the
+		// KeepLatestPerKey policy
+		qint64 m_headSequence;
+		QHash<QString,qint64> m_keySequences;
+
+		bool m_deliveryPosted;
+		quint64 m_droppedCount;
+		quint64 m_enqueuedCount;
+		quint64 m_deliveredCount;
+};
+
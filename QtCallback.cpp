@@ -1,5 +1,7 @@
 #include "QtCallback.h"
 
+#include "QtSignalTrace.h"
+
 #include <QtCore/QDebug>
 #include <QtCore/QMetaMethod>
 #include <QtCore/QMetaObject>
@@ -62,14 +64,14 @@ int QtCallbackBase::unboundParameterCount() const
 	return unboundCount;
 }
 
-int QtCallbackBase::unboundParameterType(int index) const
+int QtCallbackBase::unboundParameterIndex(int index) const
 {
 	int count = parameterCount();
 	int unboundCount = 0;
 	for (int i=0; i < count; i++) {
 		if (!isBound(i)) {
 			if (unboundCount == index) {
-				return parameterType(i);
+				return i;
 			}
 			++unboundCount;
 		}
@@ -77,6 +79,18 @@ int QtCallbackBase::unboundParameterType(int index) const
 	return -1;
 }
 
+int QtCallbackBase::unboundParameterType(int index) const
+{
+	int parameter = unboundParameterIndex(index);
+	return parameter >= 0 ? parameterType(parameter) : -1;
+}
+
+QByteArray QtCallbackBase::unboundParameterTypeName(int index) const
+{
+	int parameter = unboundParameterIndex(index);
+	return parameter >= 0 ? d->method.parameterTypes().at(parameter) : QByteArray();
+}
+
 QtCallbackBase::QtCallbackBase(const QtCallbackBase& other)
 	: d(other.d)
 {
@@ -114,9 +128,20 @@ void QtCallbackBase::bind(const QVariant& value)
 	bind(minUnusedArg, value);
 }
 
+void QtCallbackBase::setScope(const QtCallbackScope& scope)
+{
+	d->scopeToken = scope.token();
+}
+
 bool QtCallbackBase::invokeWithArgs(const QGenericArgument& a1, const QGenericArgument& a2, const QGenericArgument& a3,
-                                    const QGenericArgument& a4, const QGenericArgument& a5, const QGenericArgument& a6) const
+                                    const QGenericArgument& a4, const QGenericArgument& a5, const QGenericArgument& a6,
+                                    const QGenericArgument& a7, const QGenericArgument& a8, const QGenericArgument& a9,
+                                    const QGenericArgument& a10) const
 {
+	if (d->scopeToken.isExpired()) {
+		// the callback's scope was invalidated
+		return false;
+	}
 	if (!d->receiver) {
 		// receiver was destroyed before callback could be invoked
 		qWarning() << "Unable to invoke callback.  Receiver was destroyed";
@@ -128,12 +153,18 @@ bool QtCallbackBase::invokeWithArgs(const QGenericArgument& a1, const QGenericAr
 		return false;
 	}
 
+	// QMetaMethod::invoke() accepts at most 10 arguments
+	const int MAX_ARGS = 10;
 	int invokeArgIndex = 0;
-	QGenericArgument invokeArgs[] = {a1,a2,a3,a4,a5,a6};
-	QGenericArgument args[7] = {QGenericArgument()};
+	QGenericArgument invokeArgs[MAX_ARGS] = {a1,a2,a3,a4,a5,a6,a7,a8,a9,a10};
+	QGenericArgument args[MAX_ARGS] = {QGenericArgument()};
 	QList<QByteArray> params = d->method.parameterTypes();
 	
 	int paramCount = parameterCount();
+	if (paramCount > MAX_ARGS) {
+		qWarning() << "Unable to invoke callback.  Method has more than" << MAX_ARGS << "parameters";
+		return false;
+	}
 	for (int i = 0; i < paramCount; i++) {
 		for (int k = 0; k < d->args.count(); k++) {
 			const Data::Arg& boundArg = d->args[k];
@@ -165,7 +196,10 @@ bool QtCallbackBase::invokeWithArgs(const QGenericArgument& a1, const QGenericAr
 		}
 	}
 
-	if (!d->method.invoke(d->receiver.data(), args[0], args[1], args[2], args[3], args[4], args[5], args[6])) {
+	QtSignalTrace::Scope traceScope(QtSignalTrace::CallbackInvoke, d->receiver.data(),
+	  d->method.methodIndex(), d.constData());
+	if (!d->method.invoke(d->receiver.data(), args[0], args[1], args[2], args[3], args[4], args[5], args[6],
+	                        args[7], args[8], args[9])) {
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
 		qWarning() << "Failed to invoke method" << d->method.methodSignature();
 #else
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "QtCallbackScope.h"
+
 #include <QtCore/QMetaMethod>
 #include <QtCore/QMetaType>
 #include <QtCore/QPointer>
@@ -60,7 +62,11 @@ class QtCallbackBase
 					        const QGenericArgument& arg3 = QGenericArgument(),
 							const QGenericArgument& arg4 = QGenericArgument(),
 							const QGenericArgument& arg5 = QGenericArgument(),
-							const QGenericArgument& arg6 = QGenericArgument()) const;
+							const QGenericArgument& arg6 = QGenericArgument(),
+							const QGenericArgument& arg7 = QGenericArgument(),
+							const QGenericArgument& arg8 = QGenericArgument(),
+							const QGenericArgument& arg9 = QGenericArgument(),
+							const QGenericArgument& arg10 = QGenericArgument()) const;
 
 		/** Returns the number of parameters that the bound method has. */
 		int parameterCount() const;
@@ -78,12 +84,28 @@ class QtCallbackBase
 		 */
 		int unboundParameterType(int index) const;
 
+		/** Returns the type name of the @p index'th parameter to the method
+		 * which has not yet been bound, or an empty string if there is no
+		 * such parameter.  Unlike unboundParameterType(), this does not
+		 * require the type to be registered.
+		 */
+		QByteArray unboundParameterTypeName(int index) const;
+
 		/** Returns true if the @p index'th argument to the bound method
 		 * has been set using bind()
 		 */
 		bool isBound(int index) const;
 
+		/** Attach the callback to @p scope.  Once the scope is invalidated or
+		 * destroyed, invoking the callback has no effect.
+		 */
+		void setScope(const QtCallbackScope& scope);
+
 	private:
+		// returns the position of the @p index'th unbound
+		// parameter in the method, or -1
+		int unboundParameterIndex(int index) const;
+
 		struct Data : public QSharedData
 		{
 			struct Arg
@@ -101,6 +123,7 @@ class QtCallbackBase
 #endif
 			QMetaMethod method;
 			QVarLengthArray<Arg,5> args;
+			QtCallbackScope::Token scopeToken;
 		};
 		QSharedDataPointer<Data> d;
 };
@@ -130,6 +153,8 @@ QGenericArgument makeQtArg(const T& arg)
 			   template <class T> \
 		       QtCallback ## typeCount& bind(const T& value) \
 			   { bind(QVariant::fromValue(value)); return *this; } \
+			   QtCallback ## typeCount& setScope(const QtCallbackScope& scope) \
+			   { QtCallbackBase::setScope(scope); return *this; } \
     }
 
 #define MACRO_COMMA ,
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QSharedData>
+
+/** QtCallbackScope provides a way to cancel a group of pending callbacks
+ * at once.
+ *
+ * Callbacks are attached to a scope using QtCallback::setScope(),
+ * QtMetacallAdapter::setScope() (for QtSignalForwarder bindings and delayed calls)
+ * or safe_bind(scope, object, method).  Calling invalidate() or destroying the
+ * scope turns every callback attached so far into a no-op.
+ *
+ * Invalidating a scope is O(1) regardless of how many callbacks are attached, as
+ * it only increments the scope's generation counter.  Each callback records the
+ * generation when it was attached and compares it with the scope's current
+ * generation when invoked.  No per-callback QPointer or QWeakPointer guard is needed.
+ *
+ * Example usage, ignoring the results of requests issued for a view's
+ * previous model:
+ *
+ *  void ItemView::setModel(Model* model)
+ *  {
+ *    m_requestScope.invalidate();
+ *    ...
+ *    m_fetcher->fetchPage(url, QtCallback1<QByteArray>(this, SLOT(pageFetched(QByteArray)))
+ *      .setScope(m_requestScope));
+ *  }
+ */
+class QtCallbackScope
+{
+	private:
+		struct Data : public QSharedData
+		{
+			QAtomicInt generation;
+
+			int currentGeneration() const
+			{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+				return generation.loadAcquire();
+#else
+				return generation;
+#endif
+			}
+		};
+
+	public:
+		/** A Token records the generation of a scope at the time a callback
+		 * was attached to it.  A default-constructed token is not attached to
+		 * any scope and never expires.
+		 */
+		class Token
+		{
+			public:
+				Token()
+					: m_generation(0)
+				{}
+
+				bool isNull() const
+				{
+					return !m_data;
+				}
+
+				/** Returns true if the scope has been invalidated or destroyed
+				 * since the token was created.
+				 */
+				bool isExpired() const
+				{
+					return m_data && m_data->currentGeneration() != m_generation;
+				}
+
+			private:
+				friend class QtCallbackScope;
+
+				QExplicitlySharedDataPointer<Data> m_data;
+				int m_generation;
+		};
+
+		QtCallbackScope()
+			: d(new Data)
+		{}
+
+		~QtCallbackScope()
+		{
+			invalidate();
+		}
+
+		/** Returns a token for the scope's current generation. */
+		Token token() const
+		{
+			Token token;
+			token.m_data = d;
+			token.m_generation = d->currentGeneration();
+			return token;
+		}
+
+		/** Expires all tokens which have been created so far. */
+		void invalidate()
+		{
+			d->generation.fetchAndAddOrdered(1);
+		}
+
+		int generation() const
+		{
+			return d->currentGeneration();
+		}
+
+	private:
+		Q_DISABLE_COPY(QtCallbackScope)
+
+		QExplicitlySharedDataPointer<Data> d;
+};
+
@@ -6,20 +6,159 @@
 #include <QtCore/QSharedData>
 #include <QtCore/QMetaObject>
 
-static const int QTMETACALL_MAX_ARGS = 6;
+// matches the maximum number of arguments accepted by QMetaMethod::invoke()
+static const int QTMETACALL_MAX_ARGS = 10;
 typedef int QtMetacallArgsArray[QTMETACALL_MAX_ARGS];
 
 namespace QtSignalTools
 {
 
+// meta-type ID of a receiver's return type T, or QMetaType::Void if
+// the receiver does not return a value or T is not a registered type
+template <class T, bool Registered = QMetaTypeId2<T>::Defined>
+struct ResultTypeId
+{
+	static int id() { return qMetaTypeId<T>(); }
+};
+
+template <class T>
+struct ResultTypeId<T,false>
+{
+	static int id() { return QMetaType::Void; }
+};
+
+template <class T>
+struct ResultTypeId<const T,false> : ResultTypeId<T> {};
+
+template <class T>
+struct ResultTypeId<T&,false> : ResultTypeId<T> {};
+
+// destination for a receiver's return value.  In the expression
+// '(slot, functor(args))' the overloaded comma operator below stores
+// the value if the functor returns one.  If it returns void, the
+// built-in comma operator is used instead and nothing is stored.
+struct ResultSlot
+{
+	explicit ResultSlot(void* _value)
+	: value(_value)
+	{}
+
+	void* value;
+};
+
+template <class T>
+void operator,(const ResultSlot& slot, const T& result)
+{
+	if (slot.value) {
+		*static_cast<T*>(slot.value) = result;
+	}
+}
+
 // interface for implementations of QtMetacallAdapter
 struct QtMetacallAdapterImplIface : public QSharedData
 {
 	virtual ~QtMetacallAdapterImplIface() {}
 	virtual bool invoke(const QGenericArgument* args, int count) const = 0;
 	virtual int getArgTypes(QtMetacallArgsArray args) const  = 0;
+
+	// invokes the receiver and stores its return value in 'result', which
+	// is either null or points to a value of type resultType()
+	virtual bool invokeWithResult(const QGenericArgument* args, int count, void* result) const
+	{
+		Q_UNUSED(result);
+		return invoke(args, count);
+	}
+
+	// returns the meta-type ID of the value stored by invokeWithResult()
+	virtual int resultType() const { return QMetaType::Void; }
+
+	// returns true if the receiver's first parameter is a pointer to a class
+	// which @p sender is an instance of, so that the sender can be passed to it
+	// as the first argument.  See QtSignalForwarder::PassSender.
+	virtual bool acceptsSender(const QObject* sender) const
+	{
+		Q_UNUSED(sender);
+		return false;
+	}
+
+	// returns the approximate memory used by the implementation in bytes,
+	// excluding any memory allocated by the function object itself
+	virtual int estimatedSize() const { return sizeof(*this); }
 };
 
+// checks whether a sender can be passed to a receiver parameter of type
+// T.  Only pointers to QObject or a subclass of it can accept a sender,
+// and only if the sender is an instance of that class.
+template <class T, bool IsObject>
+struct SenderObjectArg
+{
+	static bool accepts(const QObject*) { return false; }
+};
+
+template <class T>
+struct SenderObjectArg<T,true>
+{
+	static bool accepts(const QObject* sender)
+	{
+		return sender && T::staticMetaObject.cast(const_cast<QObject*>(sender)) != 0;
+	}
+};
+
+template <class T>
+struct SenderArg
+{
+	static bool accepts(const QObject*) { return false; }
+};
+
+template <class T>
+struct SenderArg<const T> : SenderArg<T> {};
+
+template <class T>
+struct SenderArg<T&> : SenderArg<T> {};
+
+template <class T>
+struct SenderArg<T*> : SenderObjectArg<T,is_base_of<QObject,T>::value> {};
+
+// the type of the first parameter in a function signature,
+// or void if it has no parameters
+template <class Signature>
+struct FirstArgType
+{
+	typedef void type;
+};
+
+#ifdef QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
+template <class R, class T, class... Args>
+struct FirstArgType<R(T,Args...)>
+{
+	typedef T type;
+};
+
+#ifdef __cpp_noexcept_function_type
+template <class R, class T, class... Args>
+struct FirstArgType<R(T,Args...) noexcept> : FirstArgType<R(T,Args...)>
+{};
+#endif
+#else
+template <class R, class T1>
+struct FirstArgType<R(T1)>
+{
+	typedef T1 type;
+};
+
+template <class R, class T1, class T2>
+struct FirstArgType<R(T1,T2)> : FirstArgType<R(T1)> {};
+
+template <class R, class T1, class T2, class T3>
+struct FirstArgType<R(T1,T2,T3)> : FirstArgType<R(T1)> {};
+
+template <class R, class T1, class T2, class T3, class T4>
+struct FirstArgType<R(T1,T2,T3,T4)> : FirstArgType<R(T1)> {};
+
+template <class R, class T1, class T2, class T3, class T4, class T5>
+struct FirstArgType<R(T1,T2,T3,T4,T5)> : FirstArgType<R(T1)> {};
+#endif
+
 struct QtCallbackImpl : public QtMetacallAdapterImplIface
 {
 	QtCallback callback;
@@ -29,16 +168,16 @@ struct QtCallbackImpl : public QtMetacallAdapterImplIface
 	{}
 
 	virtual bool invoke(const QGenericArgument* _args, int count) const {
-		const int MAX_ARGS = 6;
-		QGenericArgument args[MAX_ARGS];
-		for (int i=0; i < MAX_ARGS; i++) {
+		QGenericArgument args[QTMETACALL_MAX_ARGS];
+		for (int i=0; i < QTMETACALL_MAX_ARGS; i++) {
 			if (i < count) {
 				args[i] = _args[i];
 			} else {
 				args[i] = QGenericArgument();
 			}
 		}
-		return callback.invokeWithArgs(args[0], args[1], args[2], args[3], args[4], args[5]);
+		return callback.invokeWithArgs(args[0], args[1], args[2], args[3], args[4], args[5],
+		  args[6], args[7], args[8], args[9]);
 	}
 
 	virtual int getArgTypes(QtMetacallArgsArray args) const {
@@ -48,6 +187,22 @@ struct QtCallbackImpl : public QtMetacallAdapterImplIface
 		}
 		return count;
 	}
+
+	virtual bool acceptsSender(const QObject* sender) const {
+		// the slot's parameter type is matched by name, so it
+		// does not need to be registered
+		QByteArray type = callback.unboundParameterTypeName(0);
+		if (!sender || !type.endsWith('*')) {
+			return false;
+		}
+		type.chop(1);
+		if (type.startsWith("const ")) {
+			type.remove(0, 6);
+		}
+		return sender->inherits(type.constData());
+	}
+
+	virtual int estimatedSize() const { return sizeof(*this); }
 };
 
 template <class Functor>
@@ -64,6 +219,17 @@ struct QtMetacallAdapterImplBase : QtMetacallAdapterImplIface
 	: functor(_f)
 	{}
 
+	virtual int estimatedSize() const { return sizeof(*this); }
+
+	virtual int resultType() const {
+		return ResultTypeId<typename traits::result_type>::id();
+	}
+
+	virtual bool acceptsSender(const QObject* sender) const {
+		typedef typename FirstArgType<typename ExtractSignature<Functor>::type>::type FirstArg;
+		return SenderArg<FirstArg>::accepts(sender);
+	}
+
 	// helper for checking at runtime that the type of a signal
 	// argument matches the type of the receiver's corresponding argument
 	template <class T>
@@ -87,6 +253,84 @@ struct QtMetacallAdapterImplBase : QtMetacallAdapterImplIface
 	}
 };
 
+#ifdef QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
+// strips references and const from a receiver's parameter type, giving
+// the type of the value that the signal argument points to
+template <class T>
+struct ArgValueType
+{
+	typedef T type;
+};
+
+template <class T>
+struct ArgValueType<const T> : ArgValueType<T> {};
+
+template <class T>
+struct ArgValueType<T&> : ArgValueType<T> {};
+
+#ifdef QST_COMPILER_SUPPORTS_RVALUE_REFERENCES
+template <class T>
+struct ArgValueType<T&&> : ArgValueType<T> {};
+#endif
+
+// table of the meta-type IDs of a signature's argument types.  Qt assigns
+// IDs to custom types at runtime, so the table is filled when first used
+// rather than at compile time.  Its size is fixed at compile time.
+template <class Signature>
+struct ArgTypeTable;
+
+template <class R, class... Args>
+struct ArgTypeTable<R(Args...)>
+{
+	static const int* ids()
+	{
+		static const int table[sizeof...(Args) + 1] = {
+			qMetaTypeId<typename ArgValueType<Args>::type>()..., 0
+		};
+		return table;
+	}
+};
+
+// implementation of QtMetacallAdapterImpl for functors with any number
+// of arguments up to QTMETACALL_MAX_ARGS
+template <class Functor, int ArgCount>
+struct QtMetacallAdapterImpl : QtMetacallAdapterImplBase<Functor>
+{
+	static_assert(ArgCount <= QTMETACALL_MAX_ARGS, "Too many arguments for QtMetacallAdapter");
+
+	typedef QtMetacallAdapterImplBase<Functor> Base;
+	typedef typename ExtractSignature<Functor>::type Signature;
+
+	QtMetacallAdapterImpl(const Functor& functor) : Base(functor) {}
+
+	virtual bool invoke(const QGenericArgument* args, int count) const {
+		return invokeWithResult(args, count, 0);
+	}
+
+	virtual bool invokeWithResult(const QGenericArgument* args, int count, void* result) const {
+		if (count < ArgCount) {
+			return false;
+		}
+		(void)(ResultSlot(result), call(args, typename MakeIndexList<ArgCount>::type()));
+		return true;
+	}
+
+	virtual int getArgTypes(QtMetacallArgsArray args) const {
+		const int* types = ArgTypeTable<Signature>::ids();
+		for (int i=0; i < ArgCount; i++) {
+			args[i] = types[i];
+		}
+		return ArgCount;
+	}
+
+private:
+	template <int... Indexes>
+	typename Base::traits::result_type call(const QGenericArgument* args, IndexList<Indexes...>) const {
+		(void)args;
+		return Base::functor(*reinterpret_cast<typename ArgValueType<typename Base::traits::template arg<Indexes>::type>::type*>(args[Indexes].data())...);
+	}
+};
+#else
 template <class Functor, int ArgCount>
 struct QtMetacallAdapterImpl;
 
@@ -106,7 +350,7 @@ struct QtMetacallAdapterImpl;
 // 'argTypesExpr' is a comma-separated list of argument type IDs for
 // the arguments which the receiver expects.
 //
-// In C++11, this macro could be replaced with variadic templates
+// This is only used for compilers without variadic template support
 #define QMA_DECLARE_ADAPTER_IMPL(argCount, invokeExpr, argTypesExpr) \
   template <class Functor> \
   struct QtMetacallAdapterImpl<Functor,argCount> \
@@ -115,11 +359,14 @@ struct QtMetacallAdapterImpl;
     typedef QtMetacallAdapterImplBase<Functor> Base;\
     QtMetacallAdapterImpl(const Functor& functor) : Base(functor) {} \
     virtual bool invoke(const QGenericArgument* args, int count) const { \
+	  return invokeWithResult(args, count, 0);\
+	}\
+    virtual bool invokeWithResult(const QGenericArgument* args, int count, void* result) const { \
 	  (void)args;\
 	  if (count < argCount) {\
 	    return false; \
 	  }\
-	  Base::functor(invokeExpr);\
+	  (void)(ResultSlot(result), Base::functor(invokeExpr));\
 	  return true;\
 	}\
 	virtual int getArgTypes(QtMetacallArgsArray args) const {\
@@ -156,12 +403,18 @@ QMA_DECLARE_ADAPTER_IMPL(5,
   QMA_CAST_ARG(0) QMA_COMMA QMA_CAST_ARG(1) QMA_COMMA QMA_CAST_ARG(2) QMA_COMMA QMA_CAST_ARG(3) QMA_COMMA QMA_CAST_ARG(4),
   QMA_ARG_TYPE(0) QMA_COMMA QMA_ARG_TYPE(1) QMA_COMMA QMA_ARG_TYPE(2) QMA_COMMA QMA_ARG_TYPE(3) QMA_COMMA QMA_ARG_TYPE(4)
 )
+#endif // QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
 
 }
 
 /** A wrapper around either a QtCallback or a function object (eg.
  * std::tr1::function, boost::function, a C++11 lambda)
  * which can invoke the function given an array of QGenericArgument objects.
+ *
+ * With compilers that support variadic templates, the function may take up to
+ * QTMETACALL_MAX_ARGS arguments, which may be passed by value or const reference,
+ * and lambdas can be passed directly.  Otherwise the function may take
+ * up to 5 arguments, which must be passed by value.
  */
 class QtMetacallAdapter
 {
@@ -191,19 +444,90 @@ public:
 
 	QtMetacallAdapter(const QtMetacallAdapter& other)
 	: m_impl(other.m_impl)
+	, m_scopeToken(other.m_scopeToken)
 	{}
 
+	/** Construct a QtMetacallAdapter which uses a custom implementation
+	 * of QtMetacallAdapterImplIface.  The adapter takes ownership of @p impl.
+	 */
+	static QtMetacallAdapter fromImpl(QtSignalTools::QtMetacallAdapterImplIface* impl)
+	{
+		QtMetacallAdapter adapter;
+		adapter.m_impl = impl;
+		return adapter;
+	}
+
 	/** Attempts to invoke the receiver with a given set of arguments from
 	 * a signal invocation.
 	 */
 	bool invoke(const QGenericArgument* args, int count) const
 	{
-		if (!m_impl) {
+		if (!m_impl || m_scopeToken.isExpired()) {
 			return false;
 		}
 		return m_impl->invoke(args, count);
 	}
 
+	/** Invokes the receiver and stores its return value in @p result, which
+	 * must point to a value of type resultType().  Returns false if the
+	 * receiver could not be invoked, in which case @p result is unchanged.
+	 */
+	bool invokeWithResult(const QGenericArgument* args, int count, void* result) const
+	{
+		if (!m_impl || m_scopeToken.isExpired()) {
+			return false;
+		}
+		return m_impl->invokeWithResult(args, count, result);
+	}
+
+	/** Returns the meta-type ID of the receiver's return type.
+	 *
+	 * This is QMetaType::Void if the receiver does not return a value, if the
+	 * return type has not been declared with Q_DECLARE_METATYPE() or if the receiver
+	 * is a QtCallback.
+	 */
+	int resultType() const
+	{
+		if (!m_impl) {
+			return QMetaType::Void;
+		}
+		return m_impl->resultType();
+	}
+
+	/** Attach the adapter to @p scope.  Once the scope is invalidated or
+	 * destroyed, invoking the adapter has no effect.  This can be used to cancel
+	 * QtSignalForwarder bindings and delayed calls in bulk.
+	 */
+	QtMetacallAdapter& setScope(const QtCallbackScope& scope)
+	{
+		m_scopeToken = scope.token();
+		return *this;
+	}
+
+	/** Returns the approximate memory used by the adapter's implementation
+	 * in bytes.  This is shared between copies of the adapter.
+	 */
+	int estimatedSize() const
+	{
+		if (!m_impl) {
+			return 0;
+		}
+		return m_impl->estimatedSize();
+	}
+
+	/** Returns true if the receiver's first parameter is a pointer to a class
+	 * which @p sender is an instance of.  For function objects, this is determined
+	 * from the parameter's type at compile time.  For QtCallback receivers, it is
+	 * determined from the name of the slot's parameter type.
+	 */
+	bool acceptsSender(const QObject* sender) const
+	{
+		if (!m_impl) {
+			return false;
+		}
+		return m_impl->acceptsSender(sender);
+	}
+
 	/** Retrieves the count and types of arguments expected by the receiver */
 	int getArgTypes(QtMetacallArgsArray args) const
 	{
@@ -218,6 +542,14 @@ public:
 		return m_impl.data() == 0;
 	}
 
+	/** Returns a pointer which identifies the function that the adapter
+	 * invokes.  Copies of an adapter have the same identity.
+	 */
+	const void* identity() const
+	{
+		return m_impl.constData();
+	}
+
 	bool operator==(const QtMetacallAdapter& other) const
 	{
 		return m_impl == other.m_impl;
@@ -230,5 +562,6 @@ public:
 
 private:
 	QSharedDataPointer<QtSignalTools::QtMetacallAdapterImplIface> m_impl;
+	QtCallbackScope::Token m_scopeToken;
 };
 
@@ -0,0 +1,735 @@
+#include "QtRemoteSignal.h"
+
+#include "QtSignalForwarder.h"
+#include "QtSignalToolsPrivate.h"
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QEvent>
+#include <QtCore/QMetaMethod>
+#include <QtCore/QMetaObject>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSharedMemory>
+#include <QtCore/QVariant>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+
+#include <string.h>
+
+// The sender writes a sequence of frames to the socket.  Each frame is a
+// FrameHeader followed by its payload.  Values are stored in the byte order
+// of the sending machine, which is also the receiving machine.
+//
+// A RingFrame, sent first, holds the key of the sender's shared memory ring.
+// ChannelFrames define the channels, in order of their IDs, before any
+// emissions in them.  EmissionFrames hold the arguments of one emission,
+// encoded with the channel's QtArgumentCodec.  SharedEmissionFrames hold a
+// SharedPayload which refers to encoded arguments in the ring.
+//
+// The ring is a RingHeader followed by the ring's data.  The sender writes
+// each payload to a contiguous range starting at the head, wrapping around
+// to the start if there is not enough room before the end.  The receiver
+// releases the space in the same order once it has read the payload.
+//
+// The receiver sets the header's attached flag once it has attached to
+// the ring.  Until then the sender does not write payloads to the ring, so
+// that a sender which disconnects before the receiver has read the RingFrame
+// does not remove the ring while frames which refer to it are unread.
+
+namespace
+{
+
+// channel IDs are sent in 16 bits
+const int MAX_CHANNELS = 0xffff;
+
+const int DEFAULT_SHARED_MEMORY_THRESHOLD = 4096;
+
+enum FrameKind
+{
+	RingFrame = 1,
+	ChannelFrame = 2,
+	EmissionFrame = 3,
+	SharedEmissionFrame = 4
+};
+
+struct FrameHeader
+{
+	// size of the payload following the header in bytes
+	quint32 payloadSize;
+	quint16 kind;
+	quint16 channel;
+};
+
+struct RingHeader
+{
+	// size of the data following the header in bytes
+	quint32 capacity;
+
+	// offset at which the sender will write the next payload
+	quint32 head;
+
+	// number of bytes written by the sender and not yet released
+	// by the receiver
+	quint32 used;
+
+	// set by the receiver once it has attached to the ring
+	quint32 attached;
+};
+
+struct SharedPayload
+{
+	quint32 position;
+	quint32 size;
+
+	// number of bytes to release after reading the payload,
+	// including any space skipped at the end of the ring
+	quint32 release;
+};
+
+QEvent::Type flushEventType()
+{
+	static const QEvent::Type type = static_cast<QEvent::Type>(QEvent::registerEventType());
+	return type;
+}
+
+void appendFrame(QByteArray* buffer, FrameKind kind, int channel, const char* payload, int size)
+{
+	FrameHeader header;
+	header.payloadSize = size;
+	header.kind = kind;
+	header.channel = channel;
+	buffer->append(reinterpret_cast<const char*>(&header), sizeof(header));
+	buffer->append(payload, size);
+}
+
+bool argTypesMatch(const QtMetacallAdapter& callback, const QList<int>& typeIds)
+{
+	int receiverArgTypes[QTMETACALL_MAX_ARGS];
+	int receiverArgCount = callback.getArgTypes(receiverArgTypes);
+	for (int i=0; i < receiverArgCount; i++) {
+		if (i >= typeIds.count() || typeIds.at(i) != receiverArgTypes[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+QString uniqueRingKey(const QString& serverName)
+{
+	static QAtomicInt counter;
+	return QString("%1-%2-%3").arg(serverName).arg(QCoreApplication::applicationPid())
+	  .arg(counter.fetchAndAddRelaxed(1));
+}
+
+}
+
+QtRemoteSignalSender::QtRemoteSignalSender(QObject* parent)
+	: QObject(parent)
+	, m_socket(0)
+	, m_ring(0)
+	, m_sharedMemoryThreshold(DEFAULT_SHARED_MEMORY_THRESHOLD)
+	, m_batchEmissionCount(0)
+	, m_flushPending(false)
+	, m_sentCount(0)
+	, m_sharedPayloadCount(0)
+	, m_droppedCount(0)
+{
+}
+
+QtRemoteSignalSender::~QtRemoteSignalSender()
+{
+	disconnectFromServer();
+}
+
+bool QtRemoteSignalSender::connectToServer(const QString& serverName, int ringSize, int timeoutMs)
+{
+	disconnectFromServer();
+
+	QLocalSocket* socket = new QLocalSocket(this);
+	socket->connectToServer(serverName);
+	if (!socket->waitForConnected(timeoutMs)) {
+		qWarning() << "Unable to connect to" << serverName << ":" << socket->errorString();
+		delete socket;
+		return false;
+	}
+
+	QSharedMemory* ring = 0;
+	if (ringSize > 0) {
+		ring = new QSharedMemory(uniqueRingKey(serverName), this);
+		if (ring->create(sizeof(RingHeader) + ringSize)) {
+			RingHeader* header = static_cast<RingHeader*>(ring->data());
+			header->capacity = ringSize;
+			header->head = 0;
+			header->used = 0;
+			header->attached = 0;
+		} else {
+			qWarning() << "Unable to create shared memory for remote signals:" << ring->errorString();
+			delete ring;
+			ring = 0;
+		}
+	}
+
+	{
+		QMutexLocker lock(&m_mutex);
+		m_socket = socket;
+		m_ring = ring;
+		if (m_ring) {
+			QByteArray payload;
+			QString key = m_ring->key();
+			QtArgumentCodec::encodeValue(&payload, QMetaType::QString, &key);
+			appendFrame(&m_batch, RingFrame, 0, payload.constData(), payload.size());
+		}
+		for (int i=0; i < m_channels.count(); i++) {
+			writeChannel(i);
+		}
+	}
+	flush();
+	return true;
+}
+
+void QtRemoteSignalSender::disconnectFromServer()
+{
+	if (!m_socket) {
+		return;
+	}
+	flush();
+
+	// emissions from other threads are dropped
+	// once the pointers have been reset
+	QLocalSocket* socket;
+	QSharedMemory* ring;
+	{
+		QMutexLocker lock(&m_mutex);
+		socket = m_socket;
+		ring = m_ring;
+		m_socket = 0;
+		m_ring = 0;
+	}
+
+	socket->disconnectFromServer();
+	if (socket->state() != QLocalSocket::UnconnectedState) {
+		socket->waitForDisconnected(1000);
+	}
+	delete socket;
+
+	// on Unix, the shared memory is removed when the receiver detaches
+	// from it as well.  Payloads are only written to the ring once the
+	// receiver has attached, so any frames which refer to the ring can
+	// still be read after it is deleted here.
+	delete ring;
+}
+
+bool QtRemoteSignalSender::isConnected() const
+{
+	return m_socket && m_socket->state() == QLocalSocket::ConnectedState;
+}
+
+bool QtRemoteSignalSender::isRingAttached() const
+{
+	if (!m_ring || !m_ring->lock()) {
+		return false;
+	}
+	bool attached = static_cast<const RingHeader*>(m_ring->constData())->attached;
+	m_ring->unlock();
+	return attached;
+}
+
+void QtRemoteSignalSender::setSharedMemoryThreshold(int bytes)
+{
+	m_sharedMemoryThreshold = bytes;
+}
+
+int QtRemoteSignalSender::sharedMemoryThreshold() const
+{
+	return m_sharedMemoryThreshold;
+}
+
+qint64 QtRemoteSignalSender::sentCount() const
+{
+	return m_sentCount;
+}
+
+qint64 QtRemoteSignalSender::sharedPayloadCount() const
+{
+	return m_sharedPayloadCount;
+}
+
+qint64 QtRemoteSignalSender::droppedCount() const
+{
+	return m_droppedCount;
+}
+
+bool QtRemoteSignalSender::forward(QObject* sender, const char* signal, const QByteArray& name)
+{
+	int index = qtObjectSignalIndex(sender, signal);
+	if (index < 0) {
+		qWarning() << "No such signal" << signal << "for" << sender;
+		return false;
+	}
+
+	Channel channel;
+	channel.name = name;
+	channel.paramTypes = sender->metaObject()->method(index).parameterTypes();
+	Q_FOREACH(const QByteArray& type, channel.paramTypes) {
+		int typeId = QMetaType::type(type.constData());
+		if (typeId == 0) {
+			qWarning() << "Argument type" << type << "of" << signal+1 << "is not registered";
+			return false;
+		}
+		channel.typeIds << typeId;
+	}
+	channel.codec = QtArgumentCodec(channel.typeIds);
+
+	int channelId;
+	{
+		QMutexLocker lock(&m_mutex);
+		if (m_channels.count() >= MAX_CHANNELS) {
+			qWarning() << "Too many remote signal channels";
+			return false;
+		}
+		channelId = m_channels.count();
+		m_channels << channel;
+		if (m_socket) {
+			writeChannel(channelId);
+			scheduleFlush();
+		}
+	}
+
+	return QtSignalForwarder::connect(sender, signal, this,
+	  QtMetacallAdapter::fromImpl(new QtSignalTools::ChannelInput<QtRemoteSignalSender>(this, channelId, channel.typeIds)));
+}
+
+void QtRemoteSignalSender::writeChannel(int channelId)
+{
+	const Channel& channel = m_channels.at(channelId);
+	QByteArray payload;
+	QtArgumentCodec::encodeValue(&payload, QMetaType::QByteArray, &channel.name);
+	int typeCount = channel.paramTypes.count();
+	QtArgumentCodec::encodeValue(&payload, QMetaType::Int, &typeCount);
+	Q_FOREACH(const QByteArray& type, channel.paramTypes) {
+		QtArgumentCodec::encodeValue(&payload, QMetaType::QByteArray, &type);
+	}
+	appendFrame(&m_batch, ChannelFrame, channelId, payload.constData(), payload.size());
+}
+
+void QtRemoteSignalSender::append(int channelId, const QGenericArgument* args, int count)
+{
+	QMutexLocker lock(&m_mutex);
+	const Channel& channel = m_channels.at(channelId);
+	if (!m_socket) {
+		++m_droppedCount;
+		return;
+	}
+
+	// the payload is encoded separately rather than directly into the batch
+	// so that large payloads can be copied to the ring instead
+	m_payload.resize(0);
+	if (count < channel.typeIds.count() || !channel.codec.encode(&m_payload, args, count)) {
+		++m_droppedCount;
+		return;
+	}
+
+	if (m_payload.size() <= m_sharedMemoryThreshold || !writeShared(channelId, m_payload)) {
+		appendFrame(&m_batch, EmissionFrame, channelId, m_payload.constData(), m_payload.size());
+	}
+	++m_batchEmissionCount;
+	scheduleFlush();
+}
+
+bool QtRemoteSignalSender::writeShared(int channel, const QByteArray& payload)
+{
+	if (!m_ring || !m_ring->lock()) {
+		return false;
+	}
+
+	RingHeader* header = static_cast<RingHeader*>(m_ring->data());
+	if (!header->attached) {
+		// the receiver has not read the RingFrame yet
+		m_ring->unlock();
+		return false;
+	}
+
+	char* data = static_cast<char*>(m_ring->data()) + sizeof(RingHeader);
+	quint32 size = payload.size();
+	quint32 position = header->head;
+	quint32 skip = 0;
+	if (position + size > header->capacity) {
+		skip = header->capacity - position;
+		position = 0;
+	}
+	if (quint64(skip) + size > header->capacity - header->used) {
+		// the receiver has not caught up, so the payload
+		// is sent over the socket instead
+		m_ring->unlock();
+		return false;
+	}
+	memcpy(data + position, payload.constData(), size);
+	header->head = position + size;
+	header->used += skip + size;
+	m_ring->unlock();
+
+	SharedPayload ref;
+	ref.position = position;
+	ref.size = size;
+	ref.release = skip + size;
+	appendFrame(&m_batch, SharedEmissionFrame, channel, reinterpret_cast<const char*>(&ref), sizeof(ref));
+	++m_sharedPayloadCount;
+	return true;
+}
+
+void QtRemoteSignalSender::scheduleFlush()
+{
+	if (!m_flushPending) {
+		m_flushPending = true;
+		QCoreApplication::postEvent(this, new QEvent(flushEventType()));
+	}
+}
+
+bool QtRemoteSignalSender::event(QEvent* event)
+{
+	if (event->type() == flushEventType()) {
+		{
+			QMutexLocker lock(&m_mutex);
+			m_flushPending = false;
+		}
+		flush();
+		return true;
+	}
+	return QObject::event(event);
+}
+
+void QtRemoteSignalSender::flush()
+{
+	QMutexLocker lock(&m_mutex);
+	if (m_batch.isEmpty()) {
+		return;
+	}
+	if (isConnected() && m_socket->write(m_batch) == m_batch.size()) {
+		m_sentCount += m_batchEmissionCount;
+	} else {
+		m_droppedCount += m_batchEmissionCount;
+	}
+	m_batch.resize(0);
+	m_batchEmissionCount = 0;
+}
+
+struct QtRemoteSignalReceiver::Notify : public QtSignalTools::QtMetacallAdapterImplIface
+{
+	enum Kind
+	{
+		NewConnection,
+		ReadyRead,
+		Disconnected
+	};
+
+	Notify(QtRemoteSignalReceiver* _receiver, Kind _kind, QObject* _socket)
+		: receiver(_receiver)
+		, kind(_kind)
+		, socket(_socket)
+	{}
+
+	virtual bool invoke(const QGenericArgument*, int) const
+	{
+		switch (kind) {
+		case NewConnection:
+			receiver->acceptConnections();
+			break;
+		case ReadyRead:
+			receiver->readFrames(socket);
+			break;
+		case Disconnected:
+			receiver->removeConnection(socket);
+			break;
+		}
+		return true;
+	}
+
+	virtual int getArgTypes(QtMetacallArgsArray) const
+	{
+		return 0;
+	}
+
+	virtual int estimatedSize() const { return sizeof(*this); }
+
+	// the receiver is the context of the binding, so the
+	// binding is removed when the receiver is destroyed
+	QtRemoteSignalReceiver* receiver;
+	Kind kind;
+	QObject* socket;
+};
+
+QtRemoteSignalReceiver::QtRemoteSignalReceiver(QObject* parent)
+	: QObject(parent)
+	, m_server(0)
+	, m_receivedCount(0)
+{
+}
+
+QtRemoteSignalReceiver::~QtRemoteSignalReceiver()
+{
+	close();
+}
+
+bool QtRemoteSignalReceiver::listen(const QString& serverName)
+{
+	close();
+
+	m_server = new QLocalServer(this);
+	if (!m_server->listen(serverName)) {
+		// remove a stale socket left by a process which exited without
+		// closing the server, and try again
+		QLocalServer::removeServer(serverName);
+		if (!m_server->listen(serverName)) {
+			qWarning() << "Unable to listen on" << serverName << ":" << m_server->errorString();
+			delete m_server;
+			m_server = 0;
+			return false;
+		}
+	}
+	QtSignalForwarder::connect(m_server, SIGNAL(newConnection()), this,
+	  QtMetacallAdapter::fromImpl(new Notify(this, Notify::NewConnection, m_server)));
+	return true;
+}
+
+void QtRemoteSignalReceiver::close()
+{
+	Q_FOREACH(Connection* connection, m_connections) {
+		deleteConnection(connection);
+	}
+	m_connections.clear();
+	if (m_server) {
+		// close() may be called from a callback invoked
+		// by the server's newConnection() signal
+		m_server->close();
+		m_server->deleteLater();
+		m_server = 0;
+	}
+}
+
+bool QtRemoteSignalReceiver::isListening() const
+{
+	return m_server && m_server->isListening();
+}
+
+void QtRemoteSignalReceiver::bind(const QByteArray& channel, const QtMetacallAdapter& callback)
+{
+	m_callbacks.insert(channel, callback);
+
+	// look up the callback again for channels
+	// which have already been defined
+	Q_FOREACH(Connection* connection, m_connections) {
+		for (int i=0; i < connection->channels.count(); i++) {
+			if (connection->channels.at(i).name == channel) {
+				connection->channels[i].resolved = false;
+			}
+		}
+	}
+}
+
+qint64 QtRemoteSignalReceiver::receivedCount() const
+{
+	return m_receivedCount;
+}
+
+void QtRemoteSignalReceiver::acceptConnections()
+{
+	while (m_server && m_server->hasPendingConnections()) {
+		QLocalSocket* socket = m_server->nextPendingConnection();
+		// the socket is re-parented so that it is not deleted with the
+		// server, which may happen while the socket is emitting a signal
+		socket->setParent(this);
+		Connection* connection = new Connection;
+		connection->socket = socket;
+		m_connections.insert(socket, connection);
+
+		QtSignalForwarder::connect(socket, SIGNAL(readyRead()), this,
+		  QtMetacallAdapter::fromImpl(new Notify(this, Notify::ReadyRead, socket)));
+		QtSignalForwarder::connect(socket, SIGNAL(disconnected()), this,
+		  QtMetacallAdapter::fromImpl(new Notify(this, Notify::Disconnected, socket)));
+
+		// read any data which arrived before the
+		// notifications were connected
+		if (socket->bytesAvailable() > 0) {
+			readFrames(socket);
+		}
+	}
+}
+
+void QtRemoteSignalReceiver::removeConnection(QObject* socket)
+{
+	// read any frames which the sender wrote
+	// before it disconnected
+	Connection* connection = m_connections.value(socket);
+	if (connection && connection->reading) {
+		// readFrames() is delivering frames further up the stack
+		// and removes the connection when it finishes
+		connection->disconnected = true;
+		return;
+	}
+	if (connection && connection->socket->bytesAvailable() > 0) {
+		readFrames(socket);
+	}
+
+	connection = m_connections.take(socket);
+	if (connection) {
+		deleteConnection(connection);
+	}
+}
+
+void QtRemoteSignalReceiver::deleteConnection(Connection* connection)
+{
+	// the socket may be emitting the signal which
+	// led to the connection being removed
+	connection->socket->deleteLater();
+	delete connection->ring;
+	delete connection;
+}
+
+void QtRemoteSignalReceiver::readFrames(QObject* socket)
+{
+	Connection* connection = m_connections.value(socket);
+	if (!connection) {
+		return;
+	}
+	connection->pending.append(connection->socket->readAll());
+	if (connection->reading) {
+		// a callback started a nested event loop.  The frames are
+		// delivered by the outer call once the callback returns.
+		return;
+	}
+	connection->reading = true;
+
+	int offset = 0;
+	while (connection->pending.size() - offset >= int(sizeof(FrameHeader))) {
+		FrameHeader header;
+		memcpy(&header, connection->pending.constData() + offset, sizeof(header));
+		int frameSize = sizeof(header) + header.payloadSize;
+		if (header.payloadSize > quint32(connection->pending.size() - offset) ||
+		    connection->pending.size() - offset < frameSize) {
+			break;
+		}
+		// data appended by a nested call may reallocate the buffer, but
+		// readFrame() decodes the payload before invoking the callback
+		readFrame(connection, header.kind, header.channel,
+		  connection->pending.constData() + offset + sizeof(header), header.payloadSize);
+		offset += frameSize;
+
+		// a callback may have closed the receiver
+		if (m_connections.value(socket) != connection) {
+			return;
+		}
+	}
+	connection->pending.remove(0, offset);
+	connection->reading = false;
+
+	if (connection->disconnected) {
+		removeConnection(socket);
+	}
+}
+
+void QtRemoteSignalReceiver::readFrame(Connection* connection, int kind, int channelId, const char* payload, int size)
+{
+	if (kind == RingFrame) {
+		QString key;
+		int offset = 0;
+		if (!QtArgumentCodec::decodeValue(payload, size, &offset, QMetaType::QString, &key)) {
+			return;
+		}
+		delete connection->ring;
+		connection->ring = new QSharedMemory(key);
+		if (!connection->ring->attach()) {
+			qWarning() << "Unable to attach to shared memory for remote signals:" << connection->ring->errorString();
+			delete connection->ring;
+			connection->ring = 0;
+		} else if (connection->ring->lock()) {
+			static_cast<RingHeader*>(connection->ring->data())->attached = 1;
+			connection->ring->unlock();
+		}
+		return;
+	}
+
+	if (kind == ChannelFrame) {
+		if (channelId != connection->channels.count()) {
+			qWarning() << "Unexpected remote signal channel" << channelId;
+			return;
+		}
+		Channel channel;
+		int offset = 0;
+		int typeCount = 0;
+		bool valid = QtArgumentCodec::decodeValue(payload, size, &offset, QMetaType::QByteArray, &channel.name) &&
+		  QtArgumentCodec::decodeValue(payload, size, &offset, QMetaType::Int, &typeCount);
+		for (int i=0; valid && i < typeCount; i++) {
+			QByteArray type;
+			valid = QtArgumentCodec::decodeValue(payload, size, &offset, QMetaType::QByteArray, &type);
+			channel.paramTypes << type;
+			channel.typeIds << QMetaType::type(type.constData());
+		}
+		if (valid && typeCount <= QTMETACALL_MAX_ARGS) {
+			channel.codec = QtArgumentCodec(channel.typeIds);
+		} else {
+			// invalid channels are still added so that the IDs of later
+			// channels are correct, but emissions in them are discarded
+			qWarning() << "Invalid definition for remote signal channel" << channelId;
+			channel.resolved = true;
+		}
+		connection->channels << channel;
+		return;
+	}
+
+	if ((kind != EmissionFrame && kind != SharedEmissionFrame) || channelId >= connection->channels.count()) {
+		return;
+	}
+
+	const char* data = payload;
+	int dataSize = size;
+	SharedPayload ref;
+	if (kind == SharedEmissionFrame) {
+		if (!connection->ring || size != int(sizeof(ref))) {
+			return;
+		}
+		memcpy(&ref, payload, sizeof(ref));
+		const RingHeader* header = static_cast<const RingHeader*>(connection->ring->constData());
+		if (quint64(ref.position) + ref.size > header->capacity) {
+			return;
+		}
+		data = static_cast<const char*>(connection->ring->constData()) + sizeof(RingHeader) + ref.position;
+		dataSize = ref.size;
+	}
+
+	Channel& channel = connection->channels[channelId];
+	if (!channel.resolved) {
+		channel.callback = m_callbacks.value(channel.name);
+		if (!channel.callback.isNull() && !argTypesMatch(channel.callback, channel.typeIds)) {
+			qWarning() << "Callback arguments do not match remote signal channel" << channel.name;
+			channel.callback = QtMetacallAdapter();
+		}
+		channel.resolved = true;
+	}
+
+	QVariant values[QTMETACALL_MAX_ARGS];
+	int offset = 0;
+	bool decoded = !channel.callback.isNull() && channel.codec.decode(data, dataSize, &offset, values);
+
+	// release the space in the ring before invoking the callback,
+	// so that the sender can reuse it as soon as possible
+	if (kind == SharedEmissionFrame && connection->ring->lock()) {
+		RingHeader* header = static_cast<RingHeader*>(connection->ring->data());
+		header->used -= ref.release;
+		connection->ring->unlock();
+	}
+	if (!decoded) {
+		return;
+	}
+
+	// the callback and parameter types are copied in case the
+	// callback closes the receiver
+	QtMetacallAdapter callback = channel.callback;
+	QList<QByteArray> paramTypes = channel.paramTypes;
+	QGenericArgument args[QTMETACALL_MAX_ARGS];
+	for (int i=0; i < paramTypes.count(); i++) {
+		args[i] = QGenericArgument(paramTypes.at(i).constData(), values[i].constData());
+	}
+	++m_receivedCount;
+	callback.invoke(args, paramTypes.count());
+}
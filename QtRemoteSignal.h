@@ -0,0 +1,258 @@
+#pragma once
+
+#include "QtArgumentCodec.h"
+#include "QtMetacallAdapter.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+class QLocalServer;
+class QLocalSocket;
+class QSharedMemory;
+
+namespace QtSignalTools
+{
+template <class Target> struct ChannelInput;
+}
+
+/** QtRemoteSignalSender forwards emissions of local signals to callbacks in
+ * another process on the same machine, which are registered with a
+ * QtRemoteSignalReceiver.
+ *
+ * Each forwarded signal is a named 'channel'.  The arguments of each emission
+ * are encoded with QtArgumentCodec and sent over a QLocalSocket.  Encoded arguments
+ * larger than sharedMemoryThreshold() bytes are instead written to a ring buffer
+ * in shared memory and the receiver reads them from there, which avoids copying
+ * them through the socket.  The ring is only used once the receiver has attached
+ * to it, so payloads sent just after connecting always go through the socket.
+ *
+ * Emissions are batched and sent together when control returns to the sender's
+ * event loop, or when flush() is called.  Forwarded signals may be emitted from
+ * any thread, but connectToServer(), disconnectFromServer(), flush() and
+ * isRingAttached() must be called from the thread that the sender lives in,
+ * which owns the socket.
+ *
+ * The argument types must be registered with qRegisterMetaType<T>() in both
+ * processes, and for types which QtArgumentCodec does not handle directly,
+ * qRegisterMetaTypeStreamOperators<T>().
+ *
+ * Example usage:
+ *
+ *  // in the data service process
+ *  QtRemoteSignalSender* sender = new QtRemoteSignalSender(this);
+ *  sender->connectToServer("gui-process");
+ *  sender->forward(feed, SIGNAL(quoteReceived(QString,double)), "quotes");
+ *
+ *  // in the GUI process
+ *  QtRemoteSignalReceiver* receiver = new QtRemoteSignalReceiver(this);
+ *  receiver->bind("quotes", QtCallback(book, SLOT(updateQuote(QString,double))));
+ *  receiver->listen("gui-process");
+ *
+ * Emissions are forwarded through QtSignalForwarder bindings, for which the sender
+ * is the context object, so forwarding stops when the sender is destroyed.
+ */
+class QtRemoteSignalSender : public QObject
+{
+	// no Q_OBJECT macro here - the sender has no signals or slots
+	// of its own
+
+	public:
+		QtRemoteSignalSender(QObject* parent = 0);
+		virtual ~QtRemoteSignalSender();
+
+		/** Connects to the QtRemoteSignalReceiver listening on @p serverName and
+		 * creates a shared memory ring of @p ringSize bytes for large payloads.
+		 * If @p ringSize is 0 or the ring cannot be created, all payloads are
+		 * sent over the socket.
+		 *
+		 * Returns false if the connection is not established within @p timeoutMs.
+		 */
+		bool connectToServer(const QString& serverName, int ringSize = 4 * 1024 * 1024, int timeoutMs = 3000);
+
+		/** Sends any pending emissions and closes the connection */
+		void disconnectFromServer();
+
+		bool isConnected() const;
+
+		/** Returns true if the receiver has attached to the shared memory ring.
+		 * Until it has, all payloads are sent over the socket.
+		 */
+		bool isRingAttached() const;
+
+		/** Forwards emissions of @p signal from @p sender to the channel called
+		 * @p channel.  Signals can be forwarded before or after connecting to
+		 * the server.
+		 *
+		 * Returns false if the signal does not exist or its argument types are not
+		 * registered.
+		 */
+		bool forward(QObject* sender, const char* signal, const QByteArray& channel);
+
+		/** Sets the size in bytes above which encoded arguments are passed
+		 * through shared memory rather than the socket.  The default is 4096.
+		 */
+		void setSharedMemoryThreshold(int bytes);
+		int sharedMemoryThreshold() const;
+
+		/** Sends pending emissions immediately rather than waiting
+		 * for control to return to the event loop.
+		 */
+		void flush();
+
+		/** Returns the number of emissions sent */
+		qint64 sentCount() const;
+
+		/** Returns the number of emissions whose arguments were
+		 * passed through shared memory.
+		 */
+		qint64 sharedPayloadCount() const;
+
+		/** Returns the number of emissions which could not be sent, because the
+		 * sender was not connected or an argument could not be serialized.
+		 */
+		qint64 droppedCount() const;
+
+	protected:
+		virtual bool event(QEvent* event);
+
+	private:
+		struct Channel
+		{
+			QByteArray name;
+			QList<QByteArray> paramTypes;
+			QList<int> typeIds;
+			QtArgumentCodec codec;
+		};
+
+		// adapter which passes the arguments of a
+		// forwarded signal to append()
+		friend struct QtSignalTools::ChannelInput<QtRemoteSignalSender>;
+
+		void writeChannel(int channel);
+		void append(int channel, const QGenericArgument* args, int count);
+
+		// copies @p size bytes of @p payload into the shared memory ring and
+		// writes the frame which refers to them.  Returns false if the ring is full.
+		// writeChannel(), writeShared() and scheduleFlush() are called
+		// with m_mutex held.
+		bool writeShared(int channel, const QByteArray& payload);
+
+		void scheduleFlush();
+
+		// guards the channels, the batch and the socket and ring
+		// pointers, as forwarded signals may be emitted from any thread
+		QMutex m_mutex;
+		QList<Channel> m_channels;
+		QLocalSocket* m_socket;
+		QSharedMemory* m_ring;
+		int m_sharedMemoryThreshold;
+
+		// frames waiting to be sent, and the number
+		// of emissions which they include
+		QByteArray m_batch;
+		int m_batchEmissionCount;
+		bool m_flushPending;
+
+		QByteArray m_payload;
+		qint64 m_sentCount;
+		qint64 m_sharedPayloadCount;
+		qint64 m_droppedCount;
+};
+
+/** QtRemoteSignalReceiver accepts connections from QtRemoteSignalSender instances in
+ * other processes and invokes the callbacks bound to their channels with the
+ * arguments of each forwarded emission.
+ *
+ * Callbacks are invoked in the thread that the receiver lives in, when the
+ * receiver's event loop processes data from the senders.
+ */
+class QtRemoteSignalReceiver : public QObject
+{
+	// no Q_OBJECT macro here - the receiver has no signals or slots
+	// of its own
+
+	public:
+		QtRemoteSignalReceiver(QObject* parent = 0);
+		virtual ~QtRemoteSignalReceiver();
+
+		/** Starts listening for senders on @p serverName */
+		bool listen(const QString& serverName);
+
+		/** Stops listening and closes the connections to any senders */
+		void close();
+
+		bool isListening() const;
+
+		/** Sets the callback to invoke for emissions forwarded to @p channel.
+		 * The callback's arguments must match the arguments of the forwarded signal,
+		 * as for QtSignalForwarder::connect().  If they do not, emissions in the
+		 * channel are discarded with a warning when the sender defines the channel.
+		 */
+		void bind(const QByteArray& channel, const QtMetacallAdapter& callback);
+
+		/** Returns the number of forwarded emissions for which a callback was invoked */
+		qint64 receivedCount() const;
+
+	private:
+		struct Channel
+		{
+			Channel()
+				: resolved(false)
+			{}
+
+			QByteArray name;
+			QList<QByteArray> paramTypes;
+			QList<int> typeIds;
+			QtArgumentCodec codec;
+
+			// the callback for the channel, looked up when the
+			// first emission in the channel is received
+			bool resolved;
+			QtMetacallAdapter callback;
+		};
+
+		struct Connection
+		{
+			Connection()
+				: socket(0)
+				, ring(0)
+				, reading(false)
+				, disconnected(false)
+			{}
+
+			QLocalSocket* socket;
+			QSharedMemory* ring;
+
+			// data received which does not yet form a complete frame
+			QByteArray pending;
+
+			// set while readFrames() is invoking callbacks for this
+			// connection, so that a nested event loop started by a callback
+			// queues data rather than delivering frames a second time, and
+			// the connection is removed only once the outer call returns
+			bool reading;
+			bool disconnected;
+			QList<Channel> channels;
+		};
+
+		// adapter which passes notifications from the server
+		// and sockets to the receiver
+		struct Notify;
+
+		void acceptConnections();
+		void readFrames(QObject* socket);
+		void removeConnection(QObject* socket);
+		void deleteConnection(Connection* connection);
+
+		void readFrame(Connection* connection, int kind, int channel, const char* payload, int size);
+
+		QLocalServer* m_server;
+		QHash<QObject*, Connection*> m_connections;
+		QHash<QByteArray, QtMetacallAdapter> m_callbacks;
+		qint64 m_receivedCount;
+};
+
@@ -0,0 +1,276 @@
+#pragma once
+
+#include "FunctionUtils.h"
+
+#ifdef QST_COMPILER_SUPPORTS_COROUTINES
+
+#include "QtSignalForwarder.h"
+
+#include <QtCore/QPointer>
+#include <QtCore/QThread>
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+
+namespace QtSignalTools
+{
+
+// state shared between an awaiter and the bindings
+// which resume the waiting coroutine.
+//
+// The bindings may be invoked from other threads, possibly before the
+// awaiter has finished setting them all up.  The coroutine is resumed
+// by whichever of the first binding to fire and the end of the set up
+// happens last, so that the coroutine frame is not resumed, and possibly
+// destroyed, while await_suspend() is still using it.
+struct ResumeState
+{
+	ResumeState()
+		: guard(0)
+		, done(false)
+		, signalled(false)
+		, arrivals(2)
+	{}
+
+	std::coroutine_handle<> handle;
+
+	// the object whose thread the coroutine is resumed on
+	QPointer<QObject> context;
+
+	// the context object for the bindings set up for a wait.
+	// Deleting it removes the bindings.
+	QObject* guard;
+
+	// set by the first binding to fire, so that the others are ignored
+	std::atomic<bool> done;
+	std::atomic<bool> signalled;
+
+	// decremented when the first binding fires and when
+	// the set up is complete
+	std::atomic<int> arrivals;
+};
+
+// resumes the coroutine waiting on @p state on the thread that its context
+// object lives in, or on the current thread if there is no context object
+inline void resumeOnContextThread(const std::shared_ptr<ResumeState>& state)
+{
+	QObject* context = state->context.data();
+	if (!context || context->thread() == QThread::currentThread()) {
+		// resume directly from within the signal dispatch rather than making a
+		// round trip through the event loop
+		state->handle.resume();
+	} else {
+		std::shared_ptr<ResumeState> resumeState = state;
+		QMetaObject::invokeMethod(context, [resumeState] { resumeState->handle.resume(); },
+		  Qt::QueuedConnection);
+	}
+}
+
+// ends the wait on @p state.  @p signalled is false if the wait
+// ended because the sender or context object was destroyed
+inline void resumeAwaiter(const std::shared_ptr<ResumeState>& state, bool signalled)
+{
+	if (state->done.exchange(true)) {
+		return;
+	}
+	state->signalled = signalled;
+
+	// the binding which is invoking this function may still be executing,
+	// so the bindings are removed once control returns to the event loop
+	state->guard->deleteLater();
+
+	if (state->arrivals.fetch_sub(1) == 1) {
+		resumeOnContextThread(state);
+	}
+}
+
+// base class for awaitables which set up bindings to resume
+// a coroutine
+class QtAwaiterBase
+{
+	public:
+		QtAwaiterBase(QObject* context)
+			: m_state(new ResumeState)
+		{
+			m_state->context = context;
+		}
+
+		bool await_ready() const
+		{
+			return false;
+		}
+
+		bool await_resume() const
+		{
+			return m_state->signalled;
+		}
+
+	protected:
+		// creates the guard object for the bindings and watches for destruction
+		// of the context object
+		void beginWait(std::coroutine_handle<> handle)
+		{
+			m_state->handle = handle;
+			m_state->guard = new QObject;
+			if (m_state->context) {
+				watchDestroyed(m_state->context.data());
+			}
+		}
+
+		// resumes the coroutine with a false result if @p object is destroyed
+		// before the wait completes.  QtSignalForwarder dispatches bindings for
+		// destroyed() before removing the object's other bindings, so this works
+		// whether or not the object already has bindings.
+		void watchDestroyed(QObject* object)
+		{
+			std::shared_ptr<ResumeState> state = m_state;
+			QtSignalForwarder::connect(object, SIGNAL(destroyed(QObject*)), m_state->guard,
+			  std::function<void()>([state] { resumeAwaiter(state, false); }));
+		}
+
+		// completes the set up of a wait.  The result is returned from
+		// await_suspend(), which resumes the coroutine immediately if it is false.
+		bool finishWait()
+		{
+			// 'this' is part of the coroutine frame, which may be
+			// destroyed as soon as a binding can resume it
+			std::shared_ptr<ResumeState> state = m_state;
+			if (state->arrivals.fetch_sub(1) != 1) {
+				// the first binding to fire will resume the coroutine
+				return true;
+			}
+
+			// a binding fired during the set up
+			QObject* context = state->context.data();
+			if (context && context->thread() != QThread::currentThread()) {
+				resumeOnContextThread(state);
+				return true;
+			}
+			return false;
+		}
+
+		// cancels a wait which could not be set up
+		bool abortWait()
+		{
+			if (!m_state->done.exchange(true)) {
+				m_state->signalled = false;
+			}
+			delete m_state->guard;
+			m_state->guard = 0;
+			return false;
+		}
+
+		std::function<void()> resumeFunc() const
+		{
+			std::shared_ptr<ResumeState> state = m_state;
+			return [state] { resumeAwaiter(state, true); };
+		}
+
+		std::shared_ptr<ResumeState> m_state;
+};
+
+/** Awaitable returned by qtSignal() */
+class QtSignalAwaiter : public QtAwaiterBase
+{
+	public:
+		QtSignalAwaiter(QObject* sender, const char* signal, QObject* context)
+			: QtAwaiterBase(context)
+			, m_sender(sender)
+			, m_signal(signal)
+		{}
+
+		bool await_suspend(std::coroutine_handle<> handle)
+		{
+			beginWait(handle);
+			if (!QtSignalForwarder::connect(m_sender, m_signal, m_state->guard, resumeFunc())) {
+				return abortWait();
+			}
+			watchDestroyed(m_sender);
+			return finishWait();
+		}
+
+	private:
+		QObject* m_sender;
+		const char* m_signal;
+};
+
+/** Awaitable returned by qtSleep() */
+class QtSleepAwaiter : public QtAwaiterBase
+{
+	public:
+		QtSleepAwaiter(int ms, QObject* context)
+			: QtAwaiterBase(context)
+			, m_delay(ms)
+		{}
+
+		bool await_suspend(std::coroutine_handle<> handle)
+		{
+			beginWait(handle);
+			QtSignalForwarder::delayedCall(m_delay, m_state->guard, resumeFunc());
+			return finishWait();
+		}
+
+	private:
+		int m_delay;
+};
+
+/** Suspends the current coroutine until @p sender emits @p signal.
+ *
+ * The result of the co_await expression is true if the signal was emitted
+ * or false if @p sender or @p context was destroyed first or the signal
+ * does not exist.
+ *
+ * If @p context is specified, the coroutine is always resumed on the thread that
+ * @p context lives in.  Otherwise it is resumed on the thread which emitted the
+ * signal or destroyed @p sender.  When that is the context's thread, the coroutine
+ * is resumed directly from the signal's dispatch without a round trip through the
+ * event loop.
+ *
+ * Example usage:
+ *
+ *   QtSignalTools::DetachedTask PageFetcher::fetchPage(QUrl url)
+ *   {
+ *     QNetworkReply* reply = m_manager->get(QNetworkRequest(url));
+ *     if (co_await qtSignal(reply, SIGNAL(finished()), this)) {
+ *       emit pageFetched(reply->readAll());
+ *       reply->deleteLater();
+ *     }
+ *   }
+ */
+inline QtSignalAwaiter qtSignal(QObject* sender, const char* signal, QObject* context = 0)
+{
+	return QtSignalAwaiter(sender, signal, context);
+}
+
+/** Suspends the current coroutine for at least @p ms milliseconds using
+ * QtSignalForwarder::delayedCall().  The calling thread must run an event loop.
+ *
+ * The result of the co_await expression is false if @p context was destroyed
+ * before the delay expired.
+ */
+inline QtSleepAwaiter qtSleep(int ms, QObject* context = 0)
+{
+	return QtSleepAwaiter(ms, context);
+}
+
+/** A minimal coroutine return type for coroutines which are started
+ * and run to completion without being awaited by a caller.
+ */
+struct DetachedTask
+{
+	struct promise_type
+	{
+		DetachedTask get_return_object() { return DetachedTask(); }
+		std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+		std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+}
+
+#endif // QST_COMPILER_SUPPORTS_COROUTINES
@@ -0,0 +1,336 @@
+#include "QtSignalBatcher.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QString>
+#include <QtCore/QVariant>
+#include <QtCore/QVector>
+
+struct QtSignalBatcher::Column
+{
+	virtual ~Column() {}
+
+	// appends a value to the pending batch
+	virtual void append(const void* value) = 0;
+
+	// moves the pending values into the vector which is passed
+	// to the callback and returns a pointer to it
+	virtual const void* takeBatch() = 0;
+
+	// clears the vector returned by takeBatch()
+	virtual void releaseBatch() = 0;
+};
+
+template <class T>
+struct QtSignalBatcher::VectorColumn : public QtSignalBatcher::Column
+{
+	virtual void append(const void* value)
+	{
+		pending.append(*static_cast<const T*>(value));
+	}
+
+	virtual const void* takeBatch()
+	{
+		// the vectors are swapped rather than copied, so each keeps
+		// its capacity from one batch to the next
+		qSwap(pending, delivering);
+		return &delivering;
+	}
+
+	virtual void releaseBatch()
+	{
+		delivering.clear();
+	}
+
+	QVector<T> pending;
+	QVector<T> delivering;
+};
+
+struct QtSignalBatcher::StreamColumn : public QtSignalBatcher::Column
+{
+	StreamColumn(int _elementType, int _vectorType)
+		: elementType(_elementType)
+		, vectorType(_vectorType)
+	{}
+
+	virtual void append(const void* value)
+	{
+		pending.append(QVariant(elementType, value));
+	}
+
+	virtual const void* takeBatch()
+	{
+		// the values are written in the same form as QDataStream's
+		// operator<<() for QVector<T>, so the vector can be read back
+		// with the vector type's stream operator
+		QByteArray data;
+		{
+			QDataStream stream(&data, QIODevice::WriteOnly);
+			stream << quint32(pending.count());
+			Q_FOREACH(const QVariant& value, pending) {
+				QMetaType::save(stream, elementType, value.constData());
+			}
+		}
+		pending.clear();
+
+		delivering = QVariant(vectorType, static_cast<const void*>(0));
+		QDataStream stream(data);
+		if (!QMetaType::load(stream, vectorType, delivering.data())) {
+			qWarning() << "Unable to create batch of type" << QMetaType::typeName(vectorType);
+		}
+		return delivering.constData();
+	}
+
+	virtual void releaseBatch()
+	{
+		delivering = QVariant();
+	}
+
+	int elementType;
+	int vectorType;
+	QList<QVariant> pending;
+	QVariant delivering;
+};
+
+namespace
+{
+
+// adapter which appends the arguments of each
+// call to a QtSignalBatcher's pending batch
+struct QtSignalBatcherImpl : public QtSignalTools::QtMetacallAdapterImplIface
+{
+	QtSignalBatcher* batcher;
+	QList<int> elementTypes;
+
+	QtSignalBatcherImpl(QtSignalBatcher* _batcher, const QList<int>& _elementTypes)
+	: batcher(_batcher)
+	, elementTypes(_elementTypes)
+	{}
+
+	virtual bool invoke(const QGenericArgument* args, int count) const {
+		batcher->append(args, count);
+		return true;
+	}
+
+	virtual int getArgTypes(QtMetacallArgsArray args) const {
+		for (int i=0; i < elementTypes.count(); i++) {
+			args[i] = elementTypes.at(i);
+		}
+		return elementTypes.count();
+	}
+};
+
+// returns the type name of the elements of a QVector<T> type name,
+// or an empty string if @p vectorType is not a QVector
+QByteArray vectorElementType(const QByteArray& vectorType)
+{
+	const QByteArray prefix("QVector<");
+	if (!vectorType.startsWith(prefix) || !vectorType.endsWith('>')) {
+		return QByteArray();
+	}
+	return vectorType.mid(prefix.size(), vectorType.size() - prefix.size() - 1).trimmed();
+}
+
+}
+
+QtSignalBatcher::QtSignalBatcher(const QtMetacallAdapter& callback, QObject* parent)
+	: QObject(parent)
+	, m_callback(callback)
+	, m_valid(true)
+	, m_maxCount(0)
+	, m_maxDelay(0)
+	, m_pendingCount(0)
+	, m_deliveryPosted(false)
+	, m_timerId(0)
+	, m_flushing(false)
+	, m_batchCount(0)
+{
+	QtMetacallArgsArray vectorTypes;
+	int argCount = m_callback.getArgTypes(vectorTypes);
+	if (argCount == 0) {
+		qWarning() << "Batch callback takes no arguments";
+		m_valid = false;
+	}
+
+	for (int i=0; i < argCount && m_valid; i++) {
+		QByteArray vectorTypeName = QMetaType::typeName(vectorTypes[i]);
+		int elementType = QMetaType::type(vectorElementType(vectorTypeName).constData());
+		if (elementType == 0) {
+			qWarning() << "Argument" << i << "of batch callback is not a QVector of a registered type:"
+			  << vectorTypeName;
+			m_valid = false;
+			break;
+		}
+
+		Column* column = 0;
+		switch (elementType) {
+		case QMetaType::Bool:
+			column = new VectorColumn<bool>;
+			break;
+		case QMetaType::Int:
+			column = new VectorColumn<int>;
+			break;
+		case QMetaType::UInt:
+			column = new VectorColumn<uint>;
+			break;
+		case QMetaType::LongLong:
+			column = new VectorColumn<qint64>;
+			break;
+		case QMetaType::ULongLong:
+			column = new VectorColumn<quint64>;
+			break;
+		case QMetaType::Float:
+			column = new VectorColumn<float>;
+			break;
+		case QMetaType::Double:
+			column = new VectorColumn<double>;
+			break;
+		case QMetaType::QString:
+			column = new VectorColumn<QString>;
+			break;
+		case QMetaType::QByteArray:
+			column = new VectorColumn<QByteArray>;
+			break;
+		default:
+			column = new StreamColumn(elementType, vectorTypes[i]);
+			break;
+		}
+		m_columns << column;
+		m_elementTypes << elementType;
+		m_vectorTypeNames << vectorTypeName;
+	}
+}
+
+QtSignalBatcher::~QtSignalBatcher()
+{
+	qDeleteAll(m_columns);
+}
+
+bool QtSignalBatcher::isValid() const
+{
+	return m_valid;
+}
+
+void QtSignalBatcher::setMaxCount(int count)
+{
+	m_maxCount = count;
+}
+
+int QtSignalBatcher::maxCount() const
+{
+	return m_maxCount;
+}
+
+void QtSignalBatcher::setMaxDelay(int ms)
+{
+	m_maxDelay = ms;
+}
+
+int QtSignalBatcher::maxDelay() const
+{
+	return m_maxDelay;
+}
+
+int QtSignalBatcher::pendingCount() const
+{
+	return m_pendingCount;
+}
+
+quint64 QtSignalBatcher::batchCount() const
+{
+	return m_batchCount;
+}
+
+QtMetacallAdapter QtSignalBatcher::adapter()
+{
+	return QtMetacallAdapter::fromImpl(new QtSignalBatcherImpl(this, m_elementTypes));
+}
+
+QEvent::Type QtSignalBatcher::deliveryEventType()
+{
+	static int eventType = QEvent::registerEventType();
+	return static_cast<QEvent::Type>(eventType);
+}
+
+void QtSignalBatcher::append(const QGenericArgument* args, int count)
+{
+	if (!m_valid) {
+		return;
+	}
+	if (count < m_columns.count()) {
+		qWarning() << "Unable to batch call.  Expected" << m_columns.count() << "arguments but received" << count;
+		return;
+	}
+
+	for (int i=0; i < m_columns.count(); i++) {
+		m_columns.at(i)->append(args[i].data());
+	}
+	++m_pendingCount;
+
+	if (m_maxCount > 0 && m_pendingCount >= m_maxCount) {
+		flush();
+	} else {
+		scheduleDelivery();
+	}
+}
+
+void QtSignalBatcher::scheduleDelivery()
+{
+	if (m_maxDelay > 0) {
+		if (m_timerId == 0) {
+			m_timerId = startTimer(m_maxDelay);
+		}
+	} else if (!m_deliveryPosted) {
+		m_deliveryPosted = true;
+		QCoreApplication::postEvent(this, new QEvent(deliveryEventType()));
+	}
+}
+
+void QtSignalBatcher::flush()
+{
+	// emissions from the callback are added to the next batch
+	if (m_flushing || m_pendingCount == 0) {
+		return;
+	}
+	m_flushing = true;
+	if (m_timerId != 0) {
+		killTimer(m_timerId);
+		m_timerId = 0;
+	}
+
+	QGenericArgument args[QTMETACALL_MAX_ARGS];
+	for (int i=0; i < m_columns.count(); i++) {
+		args[i] = QGenericArgument(m_vectorTypeNames.at(i).constData(), m_columns.at(i)->takeBatch());
+	}
+	m_pendingCount = 0;
+	++m_batchCount;
+
+	m_callback.invoke(args, m_columns.count());
+
+	Q_FOREACH(Column* column, m_columns) {
+		column->releaseBatch();
+	}
+	m_flushing = false;
+
+	if (m_pendingCount > 0) {
+		scheduleDelivery();
+	}
+}
+
+bool QtSignalBatcher::event(QEvent* event)
+{
+	if (event->type() == deliveryEventType()) {
+		m_deliveryPosted = false;
+		flush();
+		return true;
+	}
+	return QObject::event(event);
+}
+
+void QtSignalBatcher::timerEvent(QTimerEvent* event)
+{
+	if (event->timerId() == m_timerId) {
+		flush();
+	}
+}
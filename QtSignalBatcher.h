@@ -0,0 +1,123 @@
+#pragma once
+
+#include "QtMetacallAdapter.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QEvent>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+
+/** QtSignalBatcher collects the arguments of many emissions of a signal and
+ * delivers them to a callback in one call, as one vector per argument.
+ *
+ * For a signal emitted in a tight loop, such as a per-sample valueChanged(double),
+ * this replaces a callback invocation per emission with one invocation per batch,
+ * so that the handler can process the values in bulk.
+ *
+ * The callback takes a QVector<T> for each argument T of the signal.  The vectors
+ * hold the arguments of each emission in order, so the Nth element of each vector
+ * comes from the same emission.
+ *
+ * A batch is delivered:
+ *
+ *  - When control returns to the event loop of the thread that the batcher lives in,
+ *    or maxDelay() milliseconds after the first emission in the batch, if set.
+ *  - When the batch reaches maxCount() emissions, if set.
+ *  - When flush() is called.
+ *
+ * Arguments of type bool, int, uint, qint64, quint64, float, double, QString and
+ * QByteArray are appended to the vectors directly.  For other types, the QVector<T>
+ * type must be registered with qRegisterMetaType() and
+ * qRegisterMetaTypeStreamOperators() and the values are copied into the vector
+ * using QDataStream when the batch is delivered.
+ *
+ * Example usage, updating a plot once per batch of samples:
+ *
+ *  QtSignalBatcher* batcher = new QtSignalBatcher(
+ *    QtCallback(plot, SLOT(addSamples(QVector<double>))), plot);
+ *  batcher->setMaxCount(4096);
+ *  QtSignalForwarder::connect(sensor, SIGNAL(valueChanged(double)), batcher, batcher->adapter());
+ *
+ * The batcher should be used as the context object when connecting the adapter, so that
+ * the binding is removed when the batcher is destroyed.  The sender must live in the same
+ * thread as the batcher.
+ */
+class QtSignalBatcher : public QObject
+{
+	// no Q_OBJECT macro here - delivery uses a custom event type
+	// handled in event()
+
+	public:
+		QtSignalBatcher(const QtMetacallAdapter& callback, QObject* parent = 0);
+		virtual ~QtSignalBatcher();
+
+		/** Returns true if each of the callback's arguments is a QVector of
+		 * a registered type.
+		 */
+		bool isValid() const;
+
+		/** Sets the number of emissions after which the batch is delivered
+		 * immediately.  0, the default, means that there is no limit.
+		 */
+		void setMaxCount(int count);
+		int maxCount() const;
+
+		/** Sets the time in milliseconds after the first emission in a batch at which
+		 * the batch is delivered.  0, the default, delivers the batch when control returns
+		 * to the event loop.
+		 */
+		void setMaxDelay(int ms);
+		int maxDelay() const;
+
+		/** Returns an adapter which takes the element types of the callback's
+		 * arguments and appends them to the batch when invoked.  This can be passed
+		 * to QtSignalForwarder::connect().
+		 */
+		QtMetacallAdapter adapter();
+
+		/** Appends the arguments of one emission to the batch */
+		void append(const QGenericArgument* args, int count);
+
+		/** Delivers the pending batch immediately */
+		void flush();
+
+		/** Returns the number of emissions in the pending batch */
+		int pendingCount() const;
+
+		/** Returns the number of batches which have been delivered */
+		quint64 batchCount() const;
+
+		// re-implemented from QObject
+		virtual bool event(QEvent* event);
+
+	protected:
+		virtual void timerEvent(QTimerEvent* event);
+
+	private:
+		Q_DISABLE_COPY(QtSignalBatcher)
+
+		// holds the values of one argument for the pending batch
+		// and the batch being delivered
+		struct Column;
+		template <class T> struct VectorColumn;
+		struct StreamColumn;
+
+		static QEvent::Type deliveryEventType();
+
+		void scheduleDelivery();
+
+		QtMetacallAdapter m_callback;
+		QList<int> m_elementTypes;
+		QList<QByteArray> m_vectorTypeNames;
+		QList<Column*> m_columns;
+		bool m_valid;
+
+		int m_maxCount;
+		int m_maxDelay;
+		int m_pendingCount;
+		bool m_deliveryPosted;
+		int m_timerId;
+		bool m_flushing;
+		quint64 m_batchCount;
+};
+
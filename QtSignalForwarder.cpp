@@ -1,16 +1,33 @@
 #include "QtSignalForwarder.h"
 
+#include "QtSignalToolsPrivate.h"
+#include "QtSignalTrace.h"
+#include "QtSignalWatchdog.h"
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCoreApplication>
 #include <QtCore/QDebug>
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
+#include <QtCore/QSet>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QThread>
 #include <QtCore/QTimer>
+#include <QtCore/QVarLengthArray>
+#include <QtCore/QVariant>
 #include <QThreadStorage>
 
 // method index of QObject::destroyed(QObject*) signal
 const int DESTROYED_SIGNAL_INDEX = 0;
 
+// returns true if @p signalIndex is QObject::destroyed(QObject*)
+// or its destroyed() overload
+bool isDestroyedSignal(int signalIndex)
+{
+	static const int destroyedNoArgsIndex = QObject::staticMetaObject.indexOfMethod("destroyed()");
+	return signalIndex == DESTROYED_SIGNAL_INDEX || signalIndex == destroyedNoArgsIndex;
+}
+
 // minimum ID for method IDs used in signal bindings.
 //
 // These IDs are used by QtSignalForwarder::qt_metacall() to
@@ -30,6 +47,14 @@ void destroyBindingFunc()
 	Q_ASSERT(false);
 }
 QtMetacallAdapter QtSignalForwarder::s_senderDestroyedCallback(destroyBindingFunc);
+
+// dummy function for use with the sentinel callback for priority lists.
+// qt_metacall() dispatches the list instead of calling it.
+void priorityGroupFunc()
+{
+	Q_ASSERT(false);
+}
+QtMetacallAdapter QtSignalForwarder::s_priorityGroupCallback(priorityGroupFunc);
 	
 // per-thread arrays of shared proxies used by the static connect() method
 Q_GLOBAL_STATIC(QThreadStorage<QVector<QSharedPointer<QtSignalForwarder> > >, sharedProxyList)
@@ -47,6 +72,7 @@ int qtObjectSignalIndex(const QObject* object, const char* signal)
 
 QtSignalForwarder::QtSignalForwarder(QObject* parent)
 	: QObject(parent)
+	, m_activeSignalBindingCount(0)
 {
 }
 
@@ -54,18 +80,40 @@ QtSignalForwarder::~QtSignalForwarder()
 {
 }
 
-bool QtSignalForwarder::checkTypeMatch(const QtMetacallAdapter& callback, const QList<QByteArray>& paramTypes)
+// returns a non-zero seed for the random generator of a binding
+// with random sampling.  Each binding gets a different seed so that
+// bindings for the same signal sample different emissions.
+quint32 randomSampleSeed()
+{
+	static QAtomicInt seedCount;
+	return 0x9e3779b9u * quint32(seedCount.fetchAndAddRelaxed(1) + 1);
+}
+
+bool QtSignalForwarder::checkTypeMatch(const QtMetacallAdapter& callback, const QList<QByteArray>& paramTypes,
+	BindingFlags flags, const QObject* sender)
 {
 	int receiverArgTypes[QTMETACALL_MAX_ARGS] = {-1};
 	int receiverArgCount = callback.getArgTypes(receiverArgTypes);
 
-	for (int i=0; i < receiverArgCount; i++) {
-		if (i >= paramTypes.count()) {
+	// index of the first receiver argument which
+	// is supplied by the signal
+	int firstSignalArg = 0;
+	if (flags & PassSender) {
+		if (receiverArgCount < 1 || !callback.acceptsSender(sender)) {
+			qWarning() << "Receiver does not accept a pointer to" << sender << "as its first argument";
+			return false;
+		}
+		firstSignalArg = 1;
+	}
+
+	for (int i=firstSignalArg; i < receiverArgCount; i++) {
+		int signalArg = i - firstSignalArg;
+		if (signalArg >= paramTypes.count()) {
 			qWarning() << "Missing argument" << i << ": "
 			  << "Receiver expects" << QLatin1String(QMetaType::typeName(receiverArgTypes[i]));
 			return false;
 		}
-		int type = QMetaType::type(paramTypes.at(i).data());
+		int type = QMetaType::type(paramTypes.at(signalArg).data());
 		if (type != receiverArgTypes[i]) {
 			qWarning() << "Type mismatch for argument" << i << ": "
 			  << "Signal sends" << QLatin1String(QMetaType::typeName(type))
@@ -77,15 +125,130 @@ bool QtSignalForwarder::checkTypeMatch(const QtMetacallAdapter& callback, const
 	return true;
 }
 
+QtSignalForwarder::BindingOptions::BindingOptions(BindingFlags _flags)
+	: flags(_flags)
+	, hasPriority(false)
+	, dispatchPriority(0)
+	, samplingInterval(0)
+	, randomSampling(false)
+{
+}
+
+QtSignalForwarder::BindingOptions::BindingOptions(BindingFlag flag)
+	: flags(flag)
+	, hasPriority(false)
+	, dispatchPriority(0)
+	, samplingInterval(0)
+	, randomSampling(false)
+{
+}
+
+QtSignalForwarder::BindingOptions& QtSignalForwarder::BindingOptions::priority(int value)
+{
+	hasPriority = true;
+	dispatchPriority = value;
+	return *this;
+}
+
+QtSignalForwarder::BindingOptions& QtSignalForwarder::BindingOptions::sampleEvery(int interval)
+{
+	samplingInterval = interval;
+	randomSampling = false;
+	return *this;
+}
+
+QtSignalForwarder::BindingOptions& QtSignalForwarder::BindingOptions::sampleRandomly(int interval)
+{
+	samplingInterval = interval;
+	randomSampling = true;
+	return *this;
+}
+
+QtSignalForwarder::BindingOptions& QtSignalForwarder::BindingOptions::select(const QList<int>& argIndexes)
+{
+	selectedArgs = argIndexes;
+	return *this;
+}
+
+QtSignalForwarder::BindingOptions& QtSignalForwarder::BindingOptions::filter(const QtMetacallAdapter& _predicate)
+{
+	predicate = _predicate;
+	return *this;
+}
+
+QtSignalForwarder::BindingOptions& QtSignalForwarder::BindingOptions::map(const QtMetacallAdapter& _transform)
+{
+	transform = _transform;
+	return *this;
+}
+
+bool QtSignalForwarder::setupStages(Binding* binding, const BindingOptions& options,
+	QList<QByteArray>* callbackArgTypes)
+{
+	*callbackArgTypes = binding->paramTypes;
+	if (options.selectedArgs.isEmpty() && options.predicate.isNull() && options.transform.isNull()) {
+		return true;
+	}
+
+	QExplicitlySharedDataPointer<BindingStages> stages(new BindingStages);
+	if (!options.selectedArgs.isEmpty()) {
+		if (options.selectedArgs.count() > QTMETACALL_MAX_ARGS) {
+			qWarning() << "Too many selected arguments";
+			return false;
+		}
+		callbackArgTypes->clear();
+		Q_FOREACH(int index, options.selectedArgs) {
+			if (index < 0 || index >= binding->paramTypes.count()) {
+				qWarning() << "Selected argument" << index << "is out of range";
+				return false;
+			}
+			stages->selectedArgs[callbackArgTypes->count()] = index;
+			*callbackArgTypes << binding->paramTypes.at(index);
+		}
+		stages->selectedArgCount = callbackArgTypes->count();
+	}
+
+	if (!options.predicate.isNull()) {
+		if (options.predicate.resultType() != QMetaType::Bool) {
+			qWarning() << "Filter does not return a bool";
+			return false;
+		}
+		if (!checkTypeMatch(options.predicate, *callbackArgTypes)) {
+			qWarning() << "Filter arguments do not match the signal";
+			return false;
+		}
+		stages->predicate = options.predicate;
+	}
+
+	if (!options.transform.isNull()) {
+		int type = options.transform.resultType();
+		if (type == QMetaType::Void) {
+			qWarning() << "Map does not return a registered type";
+			return false;
+		}
+		if (!checkTypeMatch(options.transform, *callbackArgTypes)) {
+			qWarning() << "Map arguments do not match the signal";
+			return false;
+		}
+		stages->transform = options.transform;
+		stages->transformType = type;
+		callbackArgTypes->clear();
+		*callbackArgTypes << QMetaType::typeName(type);
+	}
+
+	binding->stages = stages;
+	return true;
+}
+
 void QtSignalForwarder::setupDestroyNotify(QObject* sender)
 {
-	if (!m_senderSignalBindingIds.contains(sender)) {
+	if (!m_senderBindings.contains(sender)) {
 		bind(sender, SIGNAL(destroyed(QObject*)), s_senderDestroyedCallback);
 	}
 }
 
 bool QtSignalForwarder::bind(QObject* sender, const char* signal, QObject *context,
-	const QtMetacallAdapter& callback
+	const QtMetacallAdapter& callback, const BindingOptions& options
 )
 {
 	int signalIndex = qtObjectSignalIndex(sender, signal);
@@ -94,24 +257,75 @@ bool QtSignalForwarder::bind(QObject* sender, const char* signal, QObject *conte
 		return false;
 	}
 
-	Binding binding(sender, signalIndex, context, callback);
+	Binding binding(sender, signalIndex, context, callback, options.flags);
 	binding.paramTypes = sender->metaObject()->method(signalIndex).parameterTypes();
+	if (options.samplingInterval > 1) {
+		binding.sampleInterval = options.samplingInterval;
+		binding.randomSampling = options.randomSampling;
+		binding.sampleState = options.randomSampling ? randomSampleSeed() : options.samplingInterval;
+	}
 
-	if (!checkTypeMatch(callback, binding.paramTypes)) {
+	QList<QByteArray> callbackArgTypes;
+	if (!setupStages(&binding, options, &callbackArgTypes)) {
+		qWarning() << "Binding stages do not match" << signal+1;
+		return false;
+	}
+
+	if (!checkTypeMatch(callback, callbackArgTypes, options.flags, sender)) {
 		qWarning() << "Sender and receiver types do not match for" << signal+1;
 		return false;
 	}
 
+	bool prioritized = options.hasPriority || (options.flags & StopPropagation);
+	if ((options.flags & StopPropagation) && callback.resultType() != QMetaType::Bool) {
+		qWarning() << "Callback for a StopPropagation binding does not return a bool";
+		return false;
+	}
+
 	if (!canAddSignalBindings()) {
 		qWarning() << "Limit of bindings per proxy has been reached";
 		return false;
 	}
 
-	if (m_freeSignalBindingIds.isEmpty()) {
-		m_freeSignalBindingIds << BINDING_METHOD_MIN_ID + m_signalBindings.count();
+	// listen for destroyed(QObject*) signal to remove all bindings.
+	// setupDestroyNotify() in turn calls bind() with s_senderDestroyedCallback
+	// as the callback.
+	//
+	// The notification is connected before the binding, so it is invoked
+	// first when the sender is destroyed, whatever the order in which the
+	// sender's bindings were added.  It dispatches the sender's own bindings
+	// for destroyed() before removing them.
+	bool isDestroyNotify = callback == s_senderDestroyedCallback;
+	if (!isDestroyNotify) {
+		setupDestroyNotify(sender);
+	}
+
+	if (prioritized) {
+		// bindings in a priority list are dispatched by the list's
+		// binding, so they do not need a connection of their own
+		int groupId = findPriorityGroup(sender, signalIndex);
+		if (groupId < 0) {
+			groupId = addPriorityGroup(sender, signalIndex, binding.paramTypes);
+			if (groupId < 0) {
+				qWarning() << "Unable to connect signal" << signal << "for" << sender;
+				releaseDestroyNotify(sender);
+				return false;
+			}
+		}
+		binding.priority = options.dispatchPriority;
+		binding.groupId = groupId;
+	}
+
+	int bindingId = allocateBindingId();
+
+	if (prioritized) {
+		QList<int>& members = m_priorityGroups[binding.groupId];
+		int index = members.count();
+		while (index > 0 && m_signalBindings.value(members.at(index-1)).priority < binding.priority) {
+			--index;
+		}
+		members.insert(index, bindingId);
 	}
-	int bindingId = m_freeSignalBindingIds.takeFirst();
-	Q_ASSERT(!m_signalBindings.contains(bindingId));
 
 	// we use Qt::DirectConnection here, so the callback will always be invoked on the same
 	// thread that the signal was delivered.  This ensures that we can rely on the object
@@ -122,30 +336,76 @@ bool QtSignalForwarder::bind(QObject* sender, const char* signal, QObject *conte
 	// If the binding's callback uses QtCallback, that will use a queued connection if the receiver
 	// actually lives in a different thread.
 	//
-	if (!QMetaObject::connect(sender, signalIndex, this, bindingId, Qt::DirectConnection, 0)) {
+	if (!prioritized && !QMetaObject::connect(sender, signalIndex, this, bindingId, Qt::DirectConnection, 0)) {
 		qWarning() << "Unable to connect signal" << signal << "for" << sender;
+		m_freeSignalBindingIds << bindingId;
+		releaseDestroyNotify(sender);
 		return false;
 	}
 
 	m_signalBindings.insert(bindingId, binding);
 
-	if (callback != s_senderDestroyedCallback) {
-		// listen for destroyed(QObject*) signal to remove
-		// all bindings.  setupDestroyNotify() in turn calls bind()
-		// with s_senderDestroyedCallback as the callback
-		setupDestroyNotify(sender);
+	if (!isDestroyNotify) {
+		++m_activeSignalBindingCount;
 	}
 	
-	m_senderSignalBindingIds.insertMulti(sender, bindingId);
+	linkBinding(&m_senderBindings, sender, bindingId, &Binding::senderLink);
 
 	if (context) {
 		setupDestroyNotify(context);
-		m_contextBindingIds.insertMulti(context, bindingId);
+		linkBinding(&m_contextBindings, context, bindingId, &Binding::contextLink);
 	}
 
 	return true;
 }
 
+int QtSignalForwarder::allocateBindingId()
+{
+	if (m_freeSignalBindingIds.isEmpty()) {
+		m_freeSignalBindingIds << BINDING_METHOD_MIN_ID + m_signalBindings.count();
+	}
+	int bindingId = m_freeSignalBindingIds.takeFirst();
+	Q_ASSERT(!m_signalBindings.contains(bindingId));
+	return bindingId;
+}
+
+int QtSignalForwarder::findPriorityGroup(QObject* sender, int signalIndex) const
+{
+	int bindingId = m_senderBindings.value(sender).first;
+	while (bindingId >= 0) {
+		const Binding& binding = *m_signalBindings.constFind(bindingId);
+		if (binding.callback == s_priorityGroupCallback && binding.signalIndex == signalIndex) {
+			return bindingId;
+		}
+		bindingId = binding.senderLink.next;
+	}
+	return -1;
+}
+
+int QtSignalForwarder::addPriorityGroup(QObject* sender, int signalIndex, const QList<QByteArray>& paramTypes)
+{
+	int groupId = allocateBindingId();
+	if (!QMetaObject::connect(sender, signalIndex, this, groupId, Qt::DirectConnection, 0)) {
+		m_freeSignalBindingIds << groupId;
+		return -1;
+	}
+
+	// the list's binding is kept while the sender has other bindings,
+	// even if the list becomes empty, so that it can be re-used
+	Binding group(sender, signalIndex, 0, s_priorityGroupCallback);
+	group.paramTypes = paramTypes;
+	m_signalBindings.insert(groupId, group);
+	linkBinding(&m_senderBindings, sender, groupId, &Binding::senderLink);
+	m_priorityGroups.insert(groupId, QList<int>());
+	return groupId;
+}
+
+bool QtSignalForwarder::isInternalBinding(const Binding& binding)
+{
+	return binding.callback == s_senderDestroyedCallback ||
+	       binding.callback == s_priorityGroupCallback;
+}
+
 bool QtSignalForwarder::bind(QObject* sender, QEvent::Type event, const QtMetacallAdapter& callback, EventFilterFunc filter)
 {
 	if (!checkTypeMatch(callback, QList<QByteArray>())) {
@@ -165,23 +425,33 @@ bool QtSignalForwarder::bind(QObject* sender, QEvent::Type event, const QtMetaca
 void QtSignalForwarder::unbind(QObject* sender, const char* signal)
 {
 	int signalIndex = qtObjectSignalIndex(sender, signal);
-	QHash<QObject*,int>::iterator iter = m_senderSignalBindingIds.find(sender);
-	while (iter != m_senderSignalBindingIds.end() && iter.key() == sender) {
-		Q_ASSERT(m_signalBindings.contains(*iter));
-		const Binding& binding = m_signalBindings.value(*iter);
+	bool removedBindings = false;
+	QList<QObject*> contexts;
+	int bindingId = m_senderBindings.value(sender).first;
+	while (bindingId >= 0) {
+		Q_ASSERT(m_signalBindings.contains(bindingId));
+		const Binding& binding = *m_signalBindings.constFind(bindingId);
+		int nextId = binding.senderLink.next;
 		if (binding.signalIndex == signalIndex) {
-			m_freeSignalBindingIds << *iter;
-			QObject* context = m_signalBindings.take(*iter).context;
-			m_contextBindingIds.remove(context, *iter);
-			iter = m_senderSignalBindingIds.erase(iter);
-		} else {
-			++iter;
+			QObject* context = takeSignalBinding(bindingId).context;
+			if (context) {
+				contexts << context;
+			}
+			removedBindings = true;
 		}
+		bindingId = nextId;
 	}
 
-	if (!isConnected(sender)) {
-		// disconnect destruction notifications
-		unbind(sender);
+	if (removedBindings) {
+		// the IDs of the removed bindings may be re-used, so the connections to
+		// them must be removed.  All bindings for this signal have been removed,
+		// so its connections to all methods of the proxy can be removed in one pass.
+		QMetaObject::disconnect(sender, signalIndex, this, -1);
+	}
+
+	releaseDestroyNotify(sender);
+	Q_FOREACH(QObject* context, contexts) {
+		releaseDestroyNotify(context);
 	}
 }
 
@@ -195,40 +465,138 @@ void QtSignalForwarder::unbind(QObject* sender, QEvent::Type event)
 			++iter;
 		}
 	}
-	if (!isConnected(sender)) {
-		// disconnect destruction notifications
-		unbind(sender);
+	if (!m_eventBindings.contains(sender)) {
+		sender->removeEventFilter(this);
 	}
+	releaseDestroyNotify(sender);
 }
 
 void QtSignalForwarder::unbind(QObject* sender)
 {
-	{
-		QHash<QObject*,int>::iterator iter = m_senderSignalBindingIds.find(sender);
-		while (iter != m_senderSignalBindingIds.end() && iter.key() == sender) {
-			m_freeSignalBindingIds << *iter;
-			QObject* context = m_signalBindings.take(*iter).context;
-			m_contextBindingIds.remove(context, *iter);
-			iter = m_senderSignalBindingIds.erase(iter);
+	QList<QObject*> affectedObjects;
+	int bindingId = m_senderBindings.value(sender).first;
+	while (bindingId >= 0) {
+		int nextId = m_signalBindings.constFind(bindingId)->senderLink.next;
+		QObject* context = takeSignalBinding(bindingId).context;
+		if (context && context != sender) {
+			affectedObjects << context;
 		}
+		bindingId = nextId;
 	}
 	m_eventBindings.remove(sender);
 
 	sender->removeEventFilter(this);
 	disconnect(sender, 0, this, 0);
 
-	{
-		QHash<QObject*,int>::iterator iter = m_contextBindingIds.find(sender);
-		while (iter != m_contextBindingIds.end() && iter.key() == sender) {
-			m_freeSignalBindingIds << *iter;
-			int id = *iter;
-			Binding x = m_signalBindings.take(id);
-			m_senderSignalBindingIds.remove(x.sender, *iter);
-			iter = m_contextBindingIds.erase(iter);
-			QMetaObject::disconnect(x.sender, x.signalIndex, this, id);
+	bindingId = m_contextBindings.value(sender).first;
+	while (bindingId >= 0) {
+		int nextId = m_signalBindings.constFind(bindingId)->contextLink.next;
+		Binding x = takeSignalBinding(bindingId);
+		QMetaObject::disconnect(x.sender, x.signalIndex, this, bindingId);
+		affectedObjects << x.sender;
+		bindingId = nextId;
+	}
+
+	// senders and contexts of the removed bindings may no longer
+	// need destruction notifications
+	Q_FOREACH(QObject* object, affectedObjects) {
+		releaseDestroyNotify(object);
+	}
+}
+
+void QtSignalForwarder::releaseDestroyNotify(QObject* object)
+{
+	if (!m_senderBindings.contains(object) ||
+	    isConnected(object) ||
+	    m_contextBindings.contains(object)) {
+		return;
+	}
+
+	// only the bindings for destruction notifications and
+	// empty priority lists remain
+	int bindingId = m_senderBindings.value(object).first;
+	while (bindingId >= 0) {
+		int nextId = m_signalBindings.constFind(bindingId)->senderLink.next;
+		takeSignalBinding(bindingId);
+		bindingId = nextId;
+	}
+	object->removeEventFilter(this);
+	disconnect(object, 0, this, 0);
+}
+
+QtSignalForwarder::Binding QtSignalForwarder::removeSignalBinding(int bindingId)
+{
+	Binding binding = takeSignalBinding(bindingId);
+
+	// the ID may be re-used, so the connection must be removed
+	QMetaObject::disconnect(binding.sender, binding.signalIndex, this, bindingId);
+
+	releaseDestroyNotify(binding.sender);
+	if (binding.context) {
+		releaseDestroyNotify(binding.context);
+	}
+	return binding;
+}
+
+QtSignalForwarder::Binding QtSignalForwarder::takeSignalBinding(int bindingId)
+{
+	m_freeSignalBindingIds << bindingId;
+	Binding binding = m_signalBindings.take(bindingId);
+	unlinkBinding(&m_senderBindings, binding.sender, binding, &Binding::senderLink);
+	if (binding.context) {
+		unlinkBinding(&m_contextBindings, binding.context, binding, &Binding::contextLink);
+	}
+	if (binding.callback == s_priorityGroupCallback) {
+		m_priorityGroups.remove(bindingId);
+	} else if (binding.callback != s_senderDestroyedCallback) {
+		--m_activeSignalBindingCount;
+	}
+	if (binding.groupId >= 0) {
+		QHash<int,QList<int> >::iterator group = m_priorityGroups.find(binding.groupId);
+		if (group != m_priorityGroups.end()) {
+			group->removeOne(bindingId);
 		}
 	}
+	return binding;
+}
 
+void QtSignalForwarder::linkBinding(QHash<QObject*,BindingList>* lists, QObject* object, int bindingId,
+	BindingLink Binding::*link)
+{
+	BindingList& list = (*lists)[object];
+	Binding& binding = m_signalBindings[bindingId];
+	(binding.*link).previous = -1;
+	(binding.*link).next = list.first;
+	if (list.first >= 0) {
+		(m_signalBindings[list.first].*link).previous = bindingId;
+	}
+	list.first = bindingId;
+	if (!isInternalBinding(binding)) {
+		++list.activeCount;
+	}
+}
+
+void QtSignalForwarder::unlinkBinding(QHash<QObject*,BindingList>* lists, QObject* object, const Binding& binding,
+	BindingLink Binding::*link)
+{
+	QHash<QObject*,BindingList>::iterator list = lists->find(object);
+	Q_ASSERT(list != lists->end());
+
+	const BindingLink& entry = binding.*link;
+	if (entry.previous >= 0) {
+		(m_signalBindings[entry.previous].*link).next = entry.next;
+	} else {
+		list->first = entry.next;
+	}
+	if (entry.next >= 0) {
+		(m_signalBindings[entry.next].*link).previous = entry.previous;
+	}
+	if (!isInternalBinding(binding)) {
+		--list->activeCount;
+	}
+	if (list->first < 0) {
+		lists->erase(list);
+	}
 }
 
 bool QtSignalForwarder::canAddSignalBindings() const
@@ -259,14 +627,30 @@ QtSignalForwarder* QtSignalForwarder::sharedProxy(QObject* sender)
 	return proxies.last().data();
 }
 
-bool QtSignalForwarder::connect(QObject* sender, const char* signal, QObject *context, const QtMetacallAdapter& callback)
+bool QtSignalForwarder::connect(QObject* sender, const char* signal, QObject *context, const QtMetacallAdapter& callback,
+	const BindingOptions& options)
 {
-	return sharedProxy(sender)->bind(sender, signal, context, callback);
+	if (options.hasPriority || (options.flags & StopPropagation)) {
+		// bindings with priorities are only ordered relative to others
+		// in the same list, so use the proxy which already has a list
+		// for this signal if there is one
+		int signalIndex = qtObjectSignalIndex(sender, signal);
+		Q_FOREACH(const QSharedPointer<QtSignalForwarder>& proxy, sharedProxyList()->localData()) {
+			if (signalIndex >= 0 && proxy->findPriorityGroup(sender, signalIndex) >= 0) {
+				return proxy->bind(sender, signal, context, callback, options);
+			}
+		}
+	}
+	return sharedProxy(sender)->bind(sender, signal, context, callback, options);
 }
 
 void QtSignalForwarder::disconnect(QObject* sender, const char* signal)
 {
-	sharedProxy(sender)->unbind(sender, signal);
+	// once a proxy reaches its binding limit, bindings for the same sender
+	// may be spread across several proxies
+	Q_FOREACH(const QSharedPointer<QtSignalForwarder>& proxy, sharedProxyList()->localData()) {
+		proxy->unbind(sender, signal);
+	}
 }
 
 bool QtSignalForwarder::connect(QObject* sender, QEvent::Type event, const QtMetacallAdapter& callback, EventFilterFunc filter)
@@ -276,7 +660,9 @@ bool QtSignalForwarder::connect(QObject* sender, QEvent::Type event, const QtMet
 
 void QtSignalForwarder::disconnect(QObject* sender, QEvent::Type event)
 {
-	sharedProxy(sender)->unbind(sender, event);
+	Q_FOREACH(const QSharedPointer<QtSignalForwarder>& proxy, sharedProxyList()->localData()) {
+		proxy->unbind(sender, event);
+	}
 }
 
 void QtSignalForwarder::failInvoke(const QString& error)
@@ -284,15 +670,169 @@ void QtSignalForwarder::failInvoke(const QString& error)
 	qWarning() << "Failed to invoke callback" << error;
 }
 
-void QtSignalForwarder::invokeBinding(const Binding& binding, void** arguments)
+bool QtSignalForwarder::invokeBinding(const Binding& binding, void** arguments)
 {
-	const int MAX_ARGS = 10;
-	int argCount = binding.paramTypes.count();
-	QGenericArgument args[MAX_ARGS];
-	for (int i=0; i < argCount; i++) {
-		args[i] = QGenericArgument(binding.paramType(0), arguments[i+1]);
+	QGenericArgument args[QTMETACALL_MAX_ARGS];
+	int argCount = 0;
+	if (binding.flags & PassSender) {
+		// the sender is passed as a QObject*, whatever the receiver's
+		// parameter type, so that the type does not need to be registered
+		args[argCount++] = QGenericArgument("QObject*", &binding.sender);
+	}
+
+	// holds the result of the map stage.  QVariant stores small values
+	// such as numbers, pointers and implicitly shared types inline,
+	// so this does not usually allocate.
+	QVariant mapped;
+
+	if (!binding.stages) {
+		int signalArgCount = qMin(binding.paramTypes.count(), QTMETACALL_MAX_ARGS - argCount);
+		for (int i=0; i < signalArgCount; i++) {
+			args[argCount++] = QGenericArgument(binding.paramType(i), arguments[i+1]);
+		}
+	} else {
+		const BindingStages& stages = *binding.stages;
+
+		// arguments passed to the filter and map stages
+		QGenericArgument stageArgs[QTMETACALL_MAX_ARGS];
+		int stageArgCount = 0;
+		if (stages.selectedArgCount >= 0) {
+			for (int i=0; i < stages.selectedArgCount; i++) {
+				int index = stages.selectedArgs[i];
+				stageArgs[stageArgCount++] = QGenericArgument(binding.paramType(index), arguments[index+1]);
+			}
+		} else {
+			stageArgCount = qMin(binding.paramTypes.count(), QTMETACALL_MAX_ARGS);
+			for (int i=0; i < stageArgCount; i++) {
+				stageArgs[i] = QGenericArgument(binding.paramType(i), arguments[i+1]);
+			}
+		}
+
+		if (!stages.predicate.isNull()) {
+			bool accepted = false;
+			if (!stages.predicate.invokeWithResult(stageArgs, stageArgCount, &accepted) || !accepted) {
+				return false;
+			}
+		}
+
+		if (!stages.transform.isNull()) {
+			mapped = QVariant(stages.transformType, static_cast<const void*>(0));
+			if (!stages.transform.invokeWithResult(stageArgs, stageArgCount, mapped.data())) {
+				return false;
+			}
+			stageArgs[0] = QGenericArgument(mapped.typeName(), mapped.constData());
+			stageArgCount = 1;
+		}
+
+		for (int i=0; i < stageArgCount && argCount < QTMETACALL_MAX_ARGS; i++) {
+			args[argCount++] = stageArgs[i];
+		}
+	}
+
+	if (binding.flags & StopPropagation) {
+		bool stop = false;
+		binding.callback.invokeWithResult(args, argCount, &stop);
+		return stop;
 	}
 	binding.callback.invoke(args, argCount);
+	return false;
+}
+
+bool QtSignalForwarder::sampleEmission(Binding* binding)
+{
+	if (binding->randomSampling) {
+		// xorshift generator, which is cheap enough to run on every emission
+		quint32 x = binding->sampleState;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		binding->sampleState = x;
+		return x % binding->sampleInterval == 0;
+	}
+	if (--binding->sampleState > 0) {
+		return false;
+	}
+	binding->sampleState = binding->sampleInterval;
+	return true;
+}
+
+bool QtSignalForwarder::dispatchBinding(const Binding& binding, void** arguments)
+{
+	QtSignalTrace::Scope traceScope(QtSignalTrace::SignalDispatch, binding.sender,
+	  binding.signalIndex, binding.callback.identity());
+	QtSignalWatchdog::Scope watchdogScope(QtSignalTrace::SignalDispatch, binding.sender,
+	  binding.signalIndex, binding.callback.identity());
+	return invokeBinding(binding, arguments);
+}
+
+void QtSignalForwarder::dispatchSignalBinding(int bindingId, Binding* binding, void** arguments)
+{
+	if (binding->callback == s_priorityGroupCallback) {
+		dispatchPriorityGroup(bindingId, arguments);
+	} else if (binding->sampleInterval && !sampleEmission(binding)) {
+		// emission skipped by sampling
+	} else if (binding->flags & SingleShot) {
+		// the binding is removed before the callback is invoked, so that
+		// re-entrant emissions do not invoke it again and the callback is
+		// free to add or remove bindings
+		Binding removed = removeSignalBinding(bindingId);
+		dispatchBinding(removed, arguments);
+	} else {
+		dispatchBinding(*binding, arguments);
+	}
+}
+
+void QtSignalForwarder::dispatchDestroyedBindings(QObject* sender, void** arguments)
+{
+	// the sender's list starts with the most recently added binding, so the
+	// IDs are collected in reverse to dispatch the bindings in the order that
+	// they were added.  Members of priority lists are dispatched by their list.
+	QList<int> bindingIds;
+	int bindingId = m_senderBindings.value(sender).first;
+	while (bindingId >= 0) {
+		const Binding& binding = *m_signalBindings.constFind(bindingId);
+		if (isDestroyedSignal(binding.signalIndex) && binding.groupId < 0 &&
+		    binding.callback != s_senderDestroyedCallback) {
+			bindingIds.prepend(bindingId);
+		}
+		bindingId = binding.senderLink.next;
+	}
+
+	// the callbacks may add or remove bindings, so each binding
+	// is looked up again before it is dispatched
+	Q_FOREACH(int bindingId, bindingIds) {
+		QHash<int,Binding>::iterator binding = m_signalBindings.find(bindingId);
+		if (binding != m_signalBindings.end() && binding->sender == sender) {
+			dispatchSignalBinding(bindingId, &*binding, arguments);
+		}
+	}
+}
+
+void QtSignalForwarder::dispatchPriorityGroup(int groupId, void** arguments)
+{
+	// the callbacks may add or remove bindings, so the list is copied
+	// and each binding is looked up again before it is invoked
+	const QList<int> memberIds = m_priorityGroups.value(groupId);
+	Q_FOREACH(int bindingId, memberIds) {
+		QHash<int,Binding>::iterator iter = m_signalBindings.find(bindingId);
+		if (iter == m_signalBindings.end() || iter->groupId != groupId) {
+			continue;
+		}
+		if (iter->sampleInterval && !sampleEmission(&*iter)) {
+			continue;
+		}
+		bool stop;
+		if (iter->flags & SingleShot) {
+			Binding binding = removeSignalBinding(bindingId);
+			stop = dispatchBinding(binding, arguments);
+		} else {
+			Binding binding = *iter;
+			stop = dispatchBinding(binding, arguments);
+		}
+		if (stop) {
+			break;
+		}
+	}
 }
 
 int QtSignalForwarder::qt_metacall(QMetaObject::Call call, int methodId, void** arguments)
@@ -305,12 +845,17 @@ int QtSignalForwarder::qt_metacall(QMetaObject::Call call, int methodId, void**
 		// - Both functions involve a mutex lock on the sender
 		// - The functions do not work for queued signals
 		//
-		QHash<int,Binding>::const_iterator iter = m_signalBindings.find(methodId);
+		QHash<int,Binding>::iterator iter = m_signalBindings.find(methodId);
 		if (iter != m_signalBindings.end()) {
 			if (iter->callback == s_senderDestroyedCallback) {
-				unbind(iter->sender);
+				// the notification is connected before the sender's other
+				// bindings, so their connections would be removed before
+				// the bindings for destroyed() could run
+				QObject* sender = iter->sender;
+				dispatchDestroyedBindings(sender, arguments);
+				unbind(sender);
 			} else {
-				invokeBinding(*iter, arguments);
+				dispatchSignalBinding(methodId, &*iter, arguments);
 			}
 		} else {
 			failInvoke(QString("Unable to find matching binding for signal %1").arg(methodId));
@@ -329,6 +874,10 @@ bool QtSignalForwarder::eventFilter(QObject* watched, QEvent* event)
 		const EventBinding& binding = iter.value();
 		if (binding.eventType == event->type() &&
 		    (!binding.filter || binding.filter(watched,event))) {
+			QtSignalTrace::Scope traceScope(QtSignalTrace::EventDispatch, watched,
+			  event->type(), binding.callback.identity());
+			QtSignalWatchdog::Scope watchdogScope(QtSignalTrace::EventDispatch, watched,
+			  event->type(), binding.callback.identity());
 			binding.callback.invoke(0, 0);
 		}
 	}
@@ -337,49 +886,471 @@ bool QtSignalForwarder::eventFilter(QObject* watched, QEvent* event)
 
 int QtSignalForwarder::bindingCount() const
 {
-	int totalSignalBindings = 0;
-	Q_FOREACH(const Binding& binding, m_signalBindings) {
-		if (binding.callback != s_senderDestroyedCallback) {
-			++totalSignalBindings;
+	return m_activeSignalBindingCount + m_eventBindings.size();
+}
+
+QtSignalForwarder::Statistics::Statistics()
+	: proxyCount(0)
+	, signalBindingCount(0)
+	, eventBindingCount(0)
+	, senderCount(0)
+	, eventFilterCount(0)
+	, estimatedBytes(0)
+{
+}
+
+template <class Key, class T>
+void addCounts(QHash<Key,T>& counts, const QHash<Key,T>& other)
+{
+	for (typename QHash<Key,T>::const_iterator iter = other.constBegin(); iter != other.constEnd(); ++iter) {
+		counts[iter.key()] += iter.value();
+	}
+}
+
+QtSignalForwarder::Statistics& QtSignalForwarder::Statistics::operator+=(const Statistics& other)
+{
+	proxyCount += other.proxyCount;
+	signalBindingCount += other.signalBindingCount;
+	eventBindingCount += other.eventBindingCount;
+	senderCount += other.senderCount;
+	eventFilterCount += other.eventFilterCount;
+	estimatedBytes += other.estimatedBytes;
+	addCounts(bindingsBySenderClass, other.bindingsBySenderClass);
+	addCounts(bindingsBySignal, other.bindingsBySignal);
+	addCounts(bindingsByEventType, other.bindingsByEventType);
+	return *this;
+}
+
+// approximate per-allocation overhead of the heap allocator
+const int HEAP_BLOCK_OVERHEAD = 2 * sizeof(void*);
+
+// approximate heap usage of a hash table, assuming one node
+// allocation per entry containing the key, value, hash and next pointer
+template <class Key, class T>
+qint64 estimatedHashSize(const QHash<Key,T>& hash)
+{
+	qint64 nodeSize = sizeof(void*) + sizeof(uint) + sizeof(Key) + sizeof(T) + HEAP_BLOCK_OVERHEAD;
+	return hash.count() * nodeSize + hash.capacity() * sizeof(void*);
+}
+
+qint64 estimatedByteArrayListSize(const QList<QByteArray>& list)
+{
+	if (list.isEmpty()) {
+		return 0;
+	}
+	// list header and array of elements
+	qint64 size = 4 * sizeof(int) + list.count() * sizeof(void*) + HEAP_BLOCK_OVERHEAD;
+	Q_FOREACH(const QByteArray& item, list) {
+		// array header and character data
+		size += 4 * sizeof(int) + sizeof(void*) + item.size() + 1 + HEAP_BLOCK_OVERHEAD;
+	}
+	return size;
+}
+
+QtSignalForwarder::Statistics QtSignalForwarder::statistics() const
+{
+	Statistics stats;
+	stats.proxyCount = 1;
+	stats.signalBindingCount = m_activeSignalBindingCount;
+	stats.eventBindingCount = m_eventBindings.count();
+
+	stats.estimatedBytes = estimatedHashSize(m_signalBindings) +
+	  estimatedHashSize(m_eventBindings) +
+	  estimatedHashSize(m_senderBindings) +
+	  estimatedHashSize(m_contextBindings) +
+	  estimatedHashSize(m_priorityGroups) +
+	  m_freeSignalBindingIds.count() * sizeof(void*);
+
+	for (QHash<int,QList<int> >::const_iterator iter = m_priorityGroups.constBegin();
+	     iter != m_priorityGroups.constEnd(); ++iter) {
+		stats.estimatedBytes += 4 * sizeof(int) + iter->count() * sizeof(void*) + HEAP_BLOCK_OVERHEAD;
+	}
+
+	// callback implementations may be shared between bindings, in which case
+	// they are only counted once
+	QSet<const void*> callbacks;
+	QSet<QObject*> senders;
+
+	for (QHash<int,Binding>::const_iterator iter = m_signalBindings.constBegin();
+	     iter != m_signalBindings.constEnd(); ++iter) {
+		const Binding& binding = iter.value();
+		stats.estimatedBytes += estimatedByteArrayListSize(binding.paramTypes);
+		if (isInternalBinding(binding)) {
+			continue;
+		}
+		if (binding.stages) {
+			stats.estimatedBytes += sizeof(BindingStages) + HEAP_BLOCK_OVERHEAD +
+			  binding.stages->predicate.estimatedSize() + binding.stages->transform.estimatedSize();
+		}
+		if (!callbacks.contains(binding.callback.identity())) {
+			callbacks.insert(binding.callback.identity());
+			stats.estimatedBytes += binding.callback.estimatedSize();
+		}
+		senders.insert(binding.sender);
+
+		const QMetaObject* metaObject = binding.sender->metaObject();
+		QByteArray className = metaObject->className();
+		++stats.bindingsBySenderClass[className];
+		++stats.bindingsBySignal[className + "::" +
+		  QtSignalTrace::detailName(QtSignalTrace::SignalDispatch, metaObject, binding.signalIndex)];
+	}
+
+	QSet<QObject*> filteredObjects;
+	for (QHash<QObject*,EventBinding>::const_iterator iter = m_eventBindings.constBegin();
+	     iter != m_eventBindings.constEnd(); ++iter) {
+		const EventBinding& binding = iter.value();
+		if (!callbacks.contains(binding.callback.identity())) {
+			callbacks.insert(binding.callback.identity());
+			stats.estimatedBytes += binding.callback.estimatedSize();
 		}
+		senders.insert(binding.sender);
+		filteredObjects.insert(binding.sender);
+
+		++stats.bindingsBySenderClass[binding.sender->metaObject()->className()];
+		++stats.bindingsByEventType[binding.eventType];
 	}
-	return totalSignalBindings + m_eventBindings.size();
+
+	stats.senderCount = senders.count();
+	stats.eventFilterCount = filteredObjects.count();
+	return stats;
+}
+
+QtSignalForwarder::Statistics QtSignalForwarder::sharedProxyStatistics()
+{
+	Statistics stats;
+	const QVector<QSharedPointer<QtSignalForwarder> >& proxies = sharedProxyList()->localData();
+	Q_FOREACH(const QSharedPointer<QtSignalForwarder>& proxy, proxies) {
+		stats += proxy->statistics();
+	}
+	return stats;
 }
 
 bool QtSignalForwarder::isConnected(QObject* sender) const
 {
-	QHash<QObject*,int>::const_iterator signalBindingIter = m_senderSignalBindingIds.find(sender);
-	while (signalBindingIter != m_senderSignalBindingIds.end() &&
-	       signalBindingIter.key() == sender) {
-		Q_ASSERT(m_signalBindings.contains(*signalBindingIter));
-		const Binding& binding = m_signalBindings.value(*signalBindingIter);
-		if (binding.callback != s_senderDestroyedCallback) {
-			return true;
-		}
-		++signalBindingIter;
+	// the sender's list counts its bindings other than destruction
+	// notifications and priority lists, so this takes constant time
+	QHash<QObject*,BindingList>::const_iterator list = m_senderBindings.constFind(sender);
+	if (list != m_senderBindings.constEnd() && list->activeCount > 0) {
+		return true;
 	}
 	return m_eventBindings.contains(sender);
 }
 
 void QtSignalForwarder::delayedCall(int ms, QObject *context, const QtMetacallAdapter& adapter)
 {
+	QtSignalTrace::instant(QtSignalTrace::DelayedCall, context, ms, adapter.identity());
+
 	QTimer* timer = new QTimer;
 	timer->setSingleShot(true);
 	timer->setInterval(ms);
-	QtSignalForwarder::connect(timer, SIGNAL(timeout()), context, adapter);
+	QtSignalForwarder::connect(timer, SIGNAL(timeout()), context, adapter, SingleShot);
 	QObject::connect(timer, SIGNAL(timeout()), timer, SLOT(deleteLater()));
 	timer->start();
 }
 
 bool QtSignalForwarder::connectWithSender(QObject* sender, const char* signal, QObject* receiver, const char* slot)
 {
-	QtCallback callback(receiver, slot);
-	int senderType = callback.parameterType(0);
-	if (senderType == 0) {
-		qWarning() << "Sender type for first argument of" << slot << "has not been registered with qRegisterMetaType<T>()";
+	return connect(sender, signal, QtCallback(receiver, slot), PassSender);
+}
+
+
+namespace
+{
+
+// holds the state of a combineLatest() or zip() join and
+// invokes the callback when all of its inputs are ready
+class QtSignalJoin : public QObject
+{
+public:
+	QtSignalJoin(bool zip, bool coalesce, const QtMetacallAdapter& callback)
+		: m_zip(zip)
+		, m_coalesce(coalesce)
+		, m_closed(false)
+		, m_flushPending(false)
+		, m_readyCount(0)
+		, m_callback(callback)
+	{}
+
+	// adds an input for a signal with the given parameter
+	// types and returns its index
+	int addInput(const QList<QByteArray>& paramTypes)
+	{
+		Input input;
+		input.paramTypes = paramTypes;
+		Q_FOREACH(const QByteArray& type, paramTypes) {
+			input.typeIds << QMetaType::type(type.constData());
+		}
+		input.latest.resize(paramTypes.count());
+		m_inputs << input;
+		return m_inputs.count() - 1;
+	}
+
+	int inputArgTypes(int index, QtMetacallArgsArray args) const
+	{
+		const Input& input = m_inputs.at(index);
+		for (int i=0; i < input.typeIds.count(); i++) {
+			args[i] = input.typeIds.at(i);
+		}
+		return input.typeIds.count();
+	}
+
+	// stops invoking the callback and deletes the join once control
+	// returns to the event loop.  This is called when one of the senders
+	// or the context object is destroyed.
+	void close()
+	{
+		if (!m_closed) {
+			m_closed = true;
+			deleteLater();
+		}
+	}
+
+	// records an emission of the signal for input @p index
+	void update(int index, const QGenericArgument* args, int count)
+	{
+		if (m_closed) {
+			return;
+		}
+
+		Input& input = m_inputs[index];
+		int argCount = qMin(count, input.typeIds.count());
+
+		if (m_zip) {
+			if (input.pending.isEmpty()) {
+				++m_readyCount;
+			}
+			QVector<QVariant> values(argCount);
+			for (int i=0; i < argCount; i++) {
+				values[i] = QVariant(input.typeIds.at(i), args[i].data());
+			}
+			input.pending.append(values);
+			if (m_readyCount == m_inputs.count()) {
+				invokeZip();
+			}
+			return;
+		}
+
+		// the values are assigned in place, so the QVariants only
+		// allocate if the values are too large to store inline
+		for (int i=0; i < argCount; i++) {
+			input.latest[i] = QVariant(input.typeIds.at(i), args[i].data());
+		}
+		if (!input.fired) {
+			input.fired = true;
+			++m_readyCount;
+		}
+		if (m_readyCount < m_inputs.count()) {
+			return;
+		}
+		if (!m_coalesce) {
+			invokeLatest();
+		} else if (!m_flushPending) {
+			m_flushPending = true;
+			QCoreApplication::postEvent(this, new QEvent(flushEventType()));
+		}
+	}
+
+protected:
+	virtual bool event(QEvent* event)
+	{
+		if (event->type() == flushEventType()) {
+			m_flushPending = false;
+			if (!m_closed) {
+				invokeLatest();
+			}
+			return true;
+		}
+		return QObject::event(event);
+	}
+
+private:
+	struct Input
+	{
+		Input()
+			: fired(false)
+		{}
+
+		QList<QByteArray> paramTypes;
+		QVector<int> typeIds;
+
+		// latest values for combineLatest()
+		bool fired;
+		QVector<QVariant> latest;
+
+		// values waiting to be paired with the other inputs for zip()
+		QList<QVector<QVariant> > pending;
+	};
+
+	static QEvent::Type flushEventType()
+	{
+		static const QEvent::Type type = static_cast<QEvent::Type>(QEvent::registerEventType());
+		return type;
+	}
+
+	void invokeLatest()
+	{
+		// the callback may emit one of the input signals, which replaces the
+		// latest values, so they are copied first
+		QVarLengthArray<QVariant, QTMETACALL_MAX_ARGS> values;
+		Q_FOREACH(const Input& input, m_inputs) {
+			Q_FOREACH(const QVariant& value, input.latest) {
+				values.append(value);
+			}
+		}
+		invoke(values.constData());
+	}
+
+	void invokeZip()
+	{
+		QVarLengthArray<QVariant, QTMETACALL_MAX_ARGS> values;
+		for (int i=0; i < m_inputs.count(); i++) {
+			Input& input = m_inputs[i];
+			Q_FOREACH(const QVariant& value, input.pending.takeFirst()) {
+				values.append(value);
+			}
+			if (input.pending.isEmpty()) {
+				--m_readyCount;
+			}
+		}
+		invoke(values.constData());
+	}
+
+	void invoke(const QVariant* values)
+	{
+		QGenericArgument args[QTMETACALL_MAX_ARGS];
+		int argCount = 0;
+		Q_FOREACH(const Input& input, m_inputs) {
+			for (int i=0; i < input.paramTypes.count(); i++) {
+				args[argCount] = QGenericArgument(input.paramTypes.at(i).constData(), values[argCount].constData());
+				++argCount;
+			}
+		}
+		m_callback.invoke(args, argCount);
+	}
+
+	bool m_zip;
+	bool m_coalesce;
+	bool m_closed;
+	bool m_flushPending;
+
+	// number of inputs which have fired (for combineLatest())
+	// or which have pending values (for zip())
+	int m_readyCount;
+
+	QList<Input> m_inputs;
+	QtMetacallAdapter m_callback;
+};
+
+// adapter which passes the arguments of an input signal to a join
+struct JoinInputImpl : public QtSignalTools::QtMetacallAdapterImplIface
+{
+	JoinInputImpl(QtSignalJoin* _join, int _input)
+		: join(_join)
+		, input(_input)
+	{}
+
+	virtual bool invoke(const QGenericArgument* args, int count) const
+	{
+		join->update(input, args, count);
+		return true;
+	}
+
+	virtual int getArgTypes(QtMetacallArgsArray args) const
+	{
+		return join->inputArgTypes(input, args);
+	}
+
+	virtual int estimatedSize() const { return sizeof(*this); }
+
+	// the join is the context of the input binding, so
+	// the binding is removed when the join is destroyed
+	QtSignalJoin* join;
+	int input;
+};
+
+// adapter which closes a join when one of its senders
+// or its context object is destroyed
+struct JoinCloseImpl : public QtSignalTools::QtMetacallAdapterImplIface
+{
+	JoinCloseImpl(QtSignalJoin* _join)
+		: join(_join)
+	{}
+
+	virtual bool invoke(const QGenericArgument*, int) const
+	{
+		join->close();
+		return true;
+	}
+
+	virtual int getArgTypes(QtMetacallArgsArray) const
+	{
+		return 0;
+	}
+
+	virtual int estimatedSize() const { return sizeof(*this); }
+
+	QtSignalJoin* join;
+};
+
+}
+
+bool QtSignalForwarder::join(JoinMode mode, const QList<SignalSource>& sources, QObject* context,
+	const QtMetacallAdapter& callback, BindingFlags flags)
+{
+	QList<QByteArray> paramTypes;
+	QList<QList<QByteArray> > sourceParamTypes;
+	Q_FOREACH(const SignalSource& source, sources) {
+		int signalIndex = qtObjectSignalIndex(source.sender, source.signal);
+		if (signalIndex < 0) {
+			qWarning() << "No such signal" << source.signal << "for" << source.sender;
+			return false;
+		}
+		QList<QByteArray> types = source.sender->metaObject()->method(signalIndex).parameterTypes();
+		Q_FOREACH(const QByteArray& type, types) {
+			if (QMetaType::type(type.constData()) == 0) {
+				qWarning() << "Argument type" << type << "of" << source.signal+1 << "is not registered";
+				return false;
+			}
+		}
+		paramTypes << types;
+		sourceParamTypes << types;
+	}
+
+	if (paramTypes.count() > QTMETACALL_MAX_ARGS) {
+		qWarning() << "Too many arguments for a join";
 		return false;
 	}
-	callback.bind(0, QVariant(senderType, &sender));
-	return connect(sender, signal, callback);
+	if (!checkTypeMatch(callback, paramTypes)) {
+		qWarning() << "Join and receiver types do not match";
+		return false;
+	}
+
+	QtSignalJoin* signalJoin = new QtSignalJoin(mode == ZipJoin, flags & CoalesceEmissions, callback);
+	QtMetacallAdapter closeJoin = QtMetacallAdapter::fromImpl(new JoinCloseImpl(signalJoin));
+	for (int i=0; i < sources.count(); i++) {
+		QObject* sender = sources.at(i).sender;
+		int input = signalJoin->addInput(sourceParamTypes.at(i));
+		if (!connect(sender, sources.at(i).signal, signalJoin,
+		      QtMetacallAdapter::fromImpl(new JoinInputImpl(signalJoin, input)))) {
+			delete signalJoin;
+			return false;
+		}
+		connect(sender, SIGNAL(destroyed(QObject*)), signalJoin, closeJoin);
+	}
+	if (context) {
+		connect(context, SIGNAL(destroyed(QObject*)), signalJoin, closeJoin);
+	}
+	return true;
 }
 
+bool QtSignalForwarder::combineLatest(const QList<SignalSource>& sources, QObject* context,
+	const QtMetacallAdapter& callback, BindingFlags flags)
+{
+	return join(CombineLatestJoin, sources, context, callback, flags);
+}
+
+bool QtSignalForwarder::zip(const QList<SignalSource>& sources, QObject* context,
+	const QtMetacallAdapter& callback)
+{
+	return join(ZipJoin, sources, context, callback, NoBindingFlags);
+}
@@ -3,6 +3,9 @@
 #include "QtMetacallAdapter.h"
 
 #include <QtCore/QEvent>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QSharedData>
 #include <QtCore/QVector>
 
 /** QtSignalForwarder provides a way to connect Qt signals to QtCallback objects
@@ -53,6 +56,153 @@ class QtSignalForwarder : public QObject
 
 		typedef bool (*EventFilterFunc)(QObject*,QEvent*);
 
+		/** Options which modify how a signal binding invokes its callback */
+		enum BindingFlag
+		{
+			NoBindingFlags = 0,
+			/** Pass the sender of the signal to the callback as its first argument,
+			 * followed by the signal's arguments.  The callback's first parameter must
+			 * be a pointer to the sender's class or one of its base classes.  The pointer
+			 * type does not need to be registered with qRegisterMetaType<T>().
+			 */
+			PassSender = 1,
+			/** For combineLatest() joins, invoke the callback at most once per event loop
+			 * iteration with the latest values, rather than once per emission.
+			 */
+			CoalesceEmissions = 2,
+			/** Remove the binding when the signal is first emitted, before the
+			 * callback is invoked.  The callback is therefore not invoked again
+			 * if it emits the signal itself.  The binding is removed even if
+			 * the emission is dropped by a filter stage.  Removing the binding
+			 * takes constant time, regardless of the number of other bindings
+			 * for the sender.
+			 */
+			SingleShot = 4,
+			/** The callback returns a bool.  If it returns true, bindings for the same
+			 * signal with a lower priority are not invoked for that emission.  The binding
+			 * is added to the signal's priority list.  See BindingOptions::priority().
+			 */
+			StopPropagation = 8
+		};
+		Q_DECLARE_FLAGS(BindingFlags, BindingFlag)
+
+		/** Options for a signal binding.
+		 *
+		 * In addition to the binding's flags, the options can specify stages which run
+		 * on each emission before the callback is invoked.  The stages operate directly
+		 * on the signal's arguments, so they avoid the cost of wrapping the callback
+		 * in another function object.  They run in the order:
+		 *
+		 *  1. select() - picks and re-orders the signal's arguments
+		 *  2. filter() - drops emissions which do not match a predicate
+		 *  3. map() - replaces the arguments with a value computed from them
+		 *
+		 * For example, to invoke a callback with the length of the text passed to
+		 * a signal's second argument, for non-empty strings only:
+		 *
+		 *  QtSignalForwarder::connect(sender, SIGNAL(itemChanged(int,QString)), updateLength,
+		 *    QtSignalForwarder::BindingOptions()
+		 *      .select(QList<int>() << 1)
+		 *      .filter(isNonEmpty)
+		 *      .map(textLength));
+		 *
+		 * Filters and maps may be function objects or plain functions, but not QtCallback
+		 * instances, since they must return a value.
+		 *
+		 * The options can also give the binding a priority, see priority().
+		 */
+		struct BindingOptions
+		{
+			BindingOptions(BindingFlags _flags = NoBindingFlags);
+			BindingOptions(BindingFlag flag);
+
+			/** Pass only the signal arguments at @p argIndexes to the later
+			 * stages and the callback, in the given order.  An index may be
+			 * repeated.
+			 */
+			BindingOptions& select(const QList<int>& argIndexes);
+
+			/** Skip the callback unless @p predicate returns true.  The predicate
+			 * receives the (selected) signal arguments and must return a bool.
+			 */
+			BindingOptions& filter(const QtMetacallAdapter& predicate);
+
+			/** Invoke the callback with the value returned by @p transform instead of
+			 * the signal's arguments.  The transform receives the (selected) signal
+			 * arguments.  Its return type must be registered with Q_DECLARE_METATYPE().
+			 */
+			BindingOptions& map(const QtMetacallAdapter& transform);
+
+			/** Add the binding to the priority list for the sender's signal.
+			 *
+			 * Bindings in the list are invoked in order of decreasing priority, and in
+			 * the order they were added for equal priorities.  Bindings with the
+			 * StopPropagation flag can skip the rest of the list.  The list as a whole
+			 * is invoked in connection order relative to bindings without a priority.
+			 */
+			BindingOptions& priority(int value);
+
+			/** Invoke the callback for only every @p interval'th emission, starting
+			 * with emission number @p interval.  Sampling is applied before the other
+			 * stages, so the skipped emissions cost only a counter update.  A SingleShot
+			 * binding is removed when its first sampled emission occurs.
+			 */
+			BindingOptions& sampleEvery(int interval);
+
+			/** Invoke the callback for a random sample of, on average, one in every
+			 * @p interval emissions.  As for sampleEvery(), sampling is applied before
+			 * the other stages.
+			 */
+			BindingOptions& sampleRandomly(int interval);
+
+			BindingFlags flags;
+			QList<int> selectedArgs;
+			QtMetacallAdapter predicate;
+			QtMetacallAdapter transform;
+			bool hasPriority;
+			int dispatchPriority;
+
+			// sampling is disabled if the interval is less than 2
+			int samplingInterval;
+			bool randomSampling;
+		};
+
+		/** A snapshot of the bindings held by one or more proxies.
+		 * See statistics() and sharedProxyStatistics().
+		 */
+		struct Statistics
+		{
+			Statistics();
+
+			/** The number of proxies included in the snapshot */
+			int proxyCount;
+			int signalBindingCount;
+			int eventBindingCount;
+
+			/** The number of distinct objects with signal or event bindings */
+			int senderCount;
+
+			/** The number of objects which the proxies have installed event filters on */
+			int eventFilterCount;
+
+			/** Approximate heap memory used by the bindings in bytes.  This includes
+			 * hash table nodes and buckets, the copies of each signal's parameter type
+			 * names and callback implementations.
+			 */
+			qint64 estimatedBytes;
+
+			/** Number of signal and event bindings for each sender class name */
+			QHash<QByteArray,int> bindingsBySenderClass;
+
+			/** Number of signal bindings for each signal, keyed by "Class::signal(args)" */
+			QHash<QByteArray,int> bindingsBySignal;
+
+			/** Number of event bindings for each event type */
+			QHash<int,int> bindingsByEventType;
+
+			Statistics& operator+=(const Statistics& other);
+		};
+
 		QtSignalForwarder(QObject* parent = 0);
 		virtual ~QtSignalForwarder();
 
@@ -65,14 +215,20 @@ class QtSignalForwarder : public QObject
 		 * object (eg. std::tr1::function).
 		 *
 		 * The connection will automatically disconnect if the sender or the
-		 * @p context context is destroyed.
+		 * @p context context is destroyed.  Bindings for the sender's destroyed()
+		 * signal are invoked before its other bindings are removed, whether they
+		 * were added before or after them.
+		 *
+		 * @p options modifies how the callback is invoked.  A BindingFlag
+		 * value can be passed directly.  See BindingOptions.
 		 */
 		bool bind(QObject* sender, const char* signal, QObject *context,
-			const QtMetacallAdapter& callback
+			const QtMetacallAdapter& callback, const BindingOptions& options = BindingOptions()
 		);
-		bool bind(QObject* sender, const char* signal, const QtMetacallAdapter& callback)
+		bool bind(QObject* sender, const char* signal, const QtMetacallAdapter& callback,
+			const BindingOptions& options = BindingOptions())
 		{
-			return bind(sender, signal, 0, callback);
+			return bind(sender, signal, 0, callback, options);
 		}
 
 		/** Set up a binding so that @p callback is invoked when @p sender
@@ -90,10 +246,27 @@ class QtSignalForwarder : public QObject
 		void unbind(QObject* sender);
 
 		/** Returns the total number of active bindings for this
-		 * QtSignalForwarder instance.
+		 * QtSignalForwarder instance.  This takes constant time.
 		 */
 		int bindingCount() const;
 
+		/** Returns a breakdown of the bindings held by this proxy and
+		 * an estimate of their memory usage.  This takes time linear in the
+		 * number of bindings.
+		 */
+		Statistics statistics() const;
+
+		/** Returns the combined statistics for the shared proxies used by the static
+		 * connect() functions in the calling thread.
+		 *
+		 * Bindings made from other threads are not included.  Each thread has its own
+		 * shared proxies, which are modified without locking, so they can only be read
+		 * safely from that thread.  To get totals for the whole application, call this
+		 * in each thread, eg. from a queued callback, and combine the results with
+		 * Statistics::operator+=().
+		 */
+		static Statistics sharedProxyStatistics();
+
 		bool isConnected(QObject* sender) const;
 
 		/** Schedule a delayed call to @p callback after @p minDelay ms.
@@ -122,13 +295,13 @@ class QtSignalForwarder : public QObject
 		 * @p context context is destroyed.
 		 */
 		static bool connect(QObject* sender, const char* signal, QObject *context,
-			const QtMetacallAdapter& callback
+			const QtMetacallAdapter& callback, const BindingOptions& options = BindingOptions()
 		);
 		static bool connect(QObject* sender, const char* signal,
-			const QtMetacallAdapter& callback
+			const QtMetacallAdapter& callback, const BindingOptions& options = BindingOptions()
 		)
 		{
-			return connect(sender, signal, 0, callback);
+			return connect(sender, signal, 0, callback, options);
 		}
 
 		static void disconnect(QObject* sender, const char* signal);
@@ -142,26 +315,142 @@ class QtSignalForwarder : public QObject
 		 * to the sender as the first argument. This can be used as an alternative to explicitly checking
 		 * the sender in the slot itself or using QSignalMapper.
 		 *
-		 * In the current implementation, the receiver type must be registered using
-		 * qRegisterMetaType<T>().
+		 * This is equivalent to connect() with the PassSender flag.
 		 *
 		 * For example: connectWithSender(myButton, SIGNAL(clicked()), myForm, SLOT(buttonClicked(QPushButton*)))
 		 */
 		static bool connectWithSender(QObject* sender, const char* signal, QObject* receiver, const char* slot);
 
+		/** Identifies a signal of a given sender, for use with combineLatest() and zip() */
+		struct SignalSource
+		{
+			SignalSource()
+				: sender(0)
+				, signal(0)
+			{}
+
+			SignalSource(QObject* _sender, const char* _signal)
+				: sender(_sender)
+				, signal(_signal)
+			{}
+
+			QObject* sender;
+			const char* signal;
+		};
+
+		/** Invoke @p callback with the latest arguments of all of the signals in
+		 * @p sources whenever one of them is emitted, once each of them has been
+		 * emitted at least once.
+		 *
+		 * The callback receives the arguments of each signal in turn, so its
+		 * parameters must match the concatenation of the signals' parameters.  The
+		 * total number of arguments is limited to QTMETACALL_MAX_ARGS and the argument
+		 * types must be registered with qRegisterMetaType<T>().  The latest values
+		 * are copied into QVariants, which store small values inline.
+		 *
+		 * If @p flags includes CoalesceEmissions, the callback is invoked at most once
+		 * per event loop iteration.
+		 *
+		 * The join is removed when any of the senders or the @p context
+		 * object is destroyed.
+		 *
+		 * For example, with C++11:
+		 *
+		 *  QtSignalForwarder::combineLatest({slider, SIGNAL(valueChanged(int))},
+		 *    {lineEdit, SIGNAL(textChanged(QString))}, updatePreview);
+		 */
+		static bool combineLatest(const QList<SignalSource>& sources, QObject* context,
+			const QtMetacallAdapter& callback, BindingFlags flags = NoBindingFlags);
+		static bool combineLatest(const SignalSource& first, const SignalSource& second,
+			const QtMetacallAdapter& callback, BindingFlags flags = NoBindingFlags)
+		{
+			return combineLatest(QList<SignalSource>() << first << second, 0, callback, flags);
+		}
+
+		/** Invoke @p callback with the arguments of the Nth emission of each of the
+		 * signals in @p sources, once all of them have been emitted N times.
+		 *
+		 * The callback's parameters and the lifetime of the join are as for
+		 * combineLatest().  Emissions are queued until the other signals catch up,
+		 * so the queue for one signal grows without limit if another signal is
+		 * never emitted.
+		 */
+		static bool zip(const QList<SignalSource>& sources, QObject* context,
+			const QtMetacallAdapter& callback);
+		static bool zip(const SignalSource& first, const SignalSource& second,
+			const QtMetacallAdapter& callback)
+		{
+			return zip(QList<SignalSource>() << first << second, 0, callback);
+		}
+
 		// re-implemented from QObject
 		virtual bool eventFilter(QObject* watched, QEvent* event);
 
 	private:
+		// the stages from a binding's options, with the argument
+		// indexes and result type resolved when the binding is created
+		struct BindingStages : public QSharedData
+		{
+			BindingStages()
+				: selectedArgCount(-1)
+				, transformType(QMetaType::Void)
+			{}
+
+			// number of entries in 'selectedArgs', or -1 if all
+			// of the signal's arguments are passed on
+			int selectedArgCount;
+			int selectedArgs[QTMETACALL_MAX_ARGS];
+			QtMetacallAdapter predicate;
+			QtMetacallAdapter transform;
+			int transformType;
+		};
+
+		// links a binding into the list of bindings for its sender or
+		// its context.  The links are binding IDs, or -1 at the ends
+		// of the list, so a binding can be removed in constant time.
+		struct BindingLink
+		{
+			BindingLink()
+				: previous(-1)
+				, next(-1)
+			{}
+
+			int previous;
+			int next;
+		};
+
+		// the list of signal bindings for a sender or context object
+		struct BindingList
+		{
+			BindingList()
+				: first(-1)
+				, activeCount(0)
+			{}
+
+			// ID of the most recently added binding
+			int first;
+
+			// number of bindings in the list, excluding
+			// internal bindings
+			int activeCount;
+		};
+
 		struct Binding
 		{
 			Binding(QObject* _sender = 0, int _signalIndex = -1,
 				QObject *_context = 0,
-				const QtMetacallAdapter& _callback = QtMetacallAdapter()
+				const QtMetacallAdapter& _callback = QtMetacallAdapter(),
+				BindingFlags _flags = NoBindingFlags
 			)
 				: sender(_sender)
 				, context(_context)
 				, signalIndex(_signalIndex)
+				, flags(_flags)
+				, priority(0)
+				, groupId(-1)
+				, sampleInterval(0)
+				, randomSampling(false)
+				, sampleState(0)
 				, callback(_callback)
 			{}
 
@@ -176,8 +465,32 @@ class QtSignalForwarder : public QObject
 			QObject* sender;
 			QObject* context;
 			int signalIndex;
+			BindingFlags flags;
+			int priority;
+
+			// ID of the binding which dispatches the priority list that this
+			// binding belongs to, or -1.  Bindings in a priority list do
+			// not have a connection of their own.
+			int groupId;
+
+			// sampling interval, or 0 if every emission is dispatched.
+			// sampleState is the number of emissions left until the next
+			// sampled emission, or the random generator's state for
+			// random sampling.
+			int sampleInterval;
+			bool randomSampling;
+			quint32 sampleState;
+
 			QList<QByteArray> paramTypes;
 			QtMetacallAdapter callback;
+
+			// links in the lists of bindings for the same
+			// sender and for the same context
+			BindingLink senderLink;
+			BindingLink contextLink;
+
+			// null unless the binding's options include stages
+			QExplicitlySharedDataPointer<BindingStages> stages;
 		};
 
 		struct EventBinding
@@ -198,34 +511,115 @@ class QtSignalForwarder : public QObject
 
 		// returns the first binding for (sender, signalIndex)
 		const Binding* matchBinding(QObject* sender, int signalIndex) const;
+
+		// returns true for the bindings used internally for destruction
+		// notifications and priority lists
+		static bool isInternalBinding(const Binding& binding);
+
+		int allocateBindingId();
+
+		// returns the ID of the binding which dispatches the priority list
+		// for (sender, signalIndex), or -1 if there is none
+		int findPriorityGroup(QObject* sender, int signalIndex) const;
+		int addPriorityGroup(QObject* sender, int signalIndex, const QList<QByteArray>& paramTypes);
+		void dispatchPriorityGroup(int groupId, void** arguments);
+
+		// dispatches the binding with ID @p bindingId for an emission
+		// of its signal
+		void dispatchSignalBinding(int bindingId, Binding* binding, void** arguments);
+
+		// dispatches the bindings for the destroyed() signal of @p sender.  This
+		// is called by the sender's destruction notification, which is connected
+		// before any of the sender's other bindings.
+		void dispatchDestroyedBindings(QObject* sender, void** arguments);
+
+		// removes a signal binding from m_signalBindings and from the lists
+		// for its sender and context and makes its ID available for re-use.
+		// The caller is responsible for removing its connection.
+		Binding takeSignalBinding(int bindingId);
+
+		// adds a binding to the head of the list for @p object in @p lists
+		// or removes it from the list.  @p link is the binding's link in
+		// that list.
+		void linkBinding(QHash<QObject*,BindingList>* lists, QObject* object, int bindingId,
+			BindingLink Binding::*link);
+		void unlinkBinding(QHash<QObject*,BindingList>* lists, QObject* object, const Binding& binding,
+			BindingLink Binding::*link);
 		void failInvoke(const QString& error);
 		void setupDestroyNotify(QObject* sender);
 
+		// removes a signal binding together with its connection and list
+		// entries.  This takes constant time, unless the sender or context is left
+		// with only internal bindings, which are then removed as well.
+		Binding removeSignalBinding(int bindingId);
+
+		// removes the destruction notification for @p object once
+		// it is no longer the sender or context of any binding
+		void releaseDestroyNotify(QObject* object);
+
 		// returns false if the limit on the number of signal bindings
 		// per proxy has been reached
 		bool canAddSignalBindings() const;
 
-		static bool checkTypeMatch(const QtMetacallAdapter& callback, const QList<QByteArray>& paramTypes);
+		// checks that @p callback accepts arguments of @p paramTypes.  With the
+		// PassSender flag, its first parameter must also accept @p sender.
+		static bool checkTypeMatch(const QtMetacallAdapter& callback, const QList<QByteArray>& paramTypes,
+			BindingFlags flags = NoBindingFlags, const QObject* sender = 0);
+		// resolves the stages in @p options against the types of the signal's
+		// arguments.  Returns false if the stages do not match the signal.
+		// On return, @p callbackArgTypes is the list of argument types which
+		// the stages pass to the callback.
+		static bool setupStages(Binding* binding, const BindingOptions& options,
+			QList<QByteArray>* callbackArgTypes);
 		static QtSignalForwarder* sharedProxy(QObject* sender);
-		static void invokeBinding(const Binding& binding, void** arguments);
 
-		// map of sender -> signal binding IDs
-		QMultiHash<QObject*,int> m_senderSignalBindingIds;
-		// map of context -> signal binding IDs
-		QMultiHash<QObject*,int> m_contextBindingIds;
+		enum JoinMode
+		{
+			CombineLatestJoin,
+			ZipJoin
+		};
+
+		// implements combineLatest() and zip()
+		static bool join(JoinMode mode, const QList<SignalSource>& sources, QObject* context,
+			const QtMetacallAdapter& callback, BindingFlags flags);
+		// invoke a binding's callback.  These return true if the callback
+		// stopped propagation to lower-priority bindings.
+		static bool invokeBinding(const Binding& binding, void** arguments);
+		static bool dispatchBinding(const Binding& binding, void** arguments);
+
+		// advances the sampling state of @p binding and returns true
+		// if the current emission should be dispatched
+		static bool sampleEmission(Binding* binding);
+
+		// map of sender -> list of signal bindings
+		QHash<QObject*,BindingList> m_senderBindings;
+		// map of context -> list of signal bindings
+		QHash<QObject*,BindingList> m_contextBindings;
 		// map of binding ID -> binding
 		QHash<int,Binding> m_signalBindings;
 		QHash<QObject*,EventBinding> m_eventBindings;
 
+		// map of priority list binding ID -> member binding IDs,
+		// in dispatch order
+		QHash<int,QList<int> > m_priorityGroups;
+
 		// list of available method IDs for new signal
 		// bindings
 		QList<int> m_freeSignalBindingIds;
 
+		// number of entries in m_signalBindings, excluding
+		// the bindings used for destruction notifications
+		int m_activeSignalBindingCount;
+
 		// a sentinel callback object for use with the automatically created
 		// bindings to QObject::destroy(QObject*) used to detect when a bound
 		// sender is destroyed
 		static QtMetacallAdapter s_senderDestroyedCallback;
+
+		// sentinel callback for the bindings which dispatch priority lists
+		static QtMetacallAdapter s_priorityGroupCallback;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(QtSignalForwarder::BindingFlags)
 Q_DECLARE_METATYPE(QtSignalForwarder*)
 
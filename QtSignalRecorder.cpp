@@ -0,0 +1,481 @@
+#include "QtSignalRecorder.h"
+
+#include "QtSignalForwarder.h"
+#include "QtSignalToolsPrivate.h"
+#include "QtSignalTrace.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QMetaMethod>
+#include <QtCore/QMetaObject>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QVariant>
+#include <QtCore/QWaitCondition>
+
+#include <string.h>
+
+// The log consists of an 8-byte magic string followed by a sequence
+// of records.  Each record is a LogRecordHeader followed by its payload,
+// padded to a multiple of 8 bytes.  Values are stored in the byte
+// order of the machine which wrote the log.
+//
+// Channel records define the channels, in order of their IDs, before
+// any emissions in them.  The payload is the channel's name and the
+// list of parameter type names, serialized with QDataStream.
+//
+// Emission records hold the arguments of one emission, encoded
+// with the channel's QtArgumentCodec.
+
+namespace
+{
+
+const char LOG_MAGIC[] = "QSTLOG02";
+const int LOG_MAGIC_SIZE = 8;
+
+// the log file is grown in steps of at least this size
+const qint64 MIN_LOG_CAPACITY = 1024 * 1024;
+
+// channel IDs are stored in 16 bits
+const int MAX_CHANNELS = 0xffff;
+
+const QDataStream::Version LOG_STREAM_VERSION = QDataStream::Qt_4_6;
+
+enum LogRecordKind
+{
+	ChannelRecord = 1,
+	EmissionRecord = 2
+};
+
+struct LogRecordHeader
+{
+	// size of the payload following the header in bytes,
+	// excluding padding
+	quint32 payloadSize;
+	quint16 kind;
+	quint16 channel;
+
+	// nanoseconds since the log was opened
+	qint64 timestamp;
+};
+
+qint64 paddedSize(qint64 size)
+{
+	return (size + 7) & ~qint64(7);
+}
+
+qint64 recordSize(qint64 payloadSize)
+{
+	return sizeof(LogRecordHeader) + paddedSize(payloadSize);
+}
+
+QByteArray signalName(const QObject* sender, int signalIndex)
+{
+	const QMetaObject* metaObject = sender->metaObject();
+	return QByteArray(metaObject->className()) + "::" +
+	  QtSignalTrace::detailName(QtSignalTrace::SignalDispatch, metaObject, signalIndex);
+}
+
+void sleepMs(int ms)
+{
+	// QThread::msleep() is not public in Qt 4
+	QMutex mutex;
+	QWaitCondition condition;
+	mutex.lock();
+	condition.wait(&mutex, ms);
+	mutex.unlock();
+}
+
+}
+
+QtSignalRecorder::QtSignalRecorder(QObject* parent)
+	: QObject(parent)
+	, m_map(0)
+	, m_capacity(0)
+	, m_size(0)
+	, m_emissionCount(0)
+	, m_droppedCount(0)
+{
+}
+
+QtSignalRecorder::~QtSignalRecorder()
+{
+	close();
+}
+
+bool QtSignalRecorder::open(const QString& path)
+{
+	close();
+
+	QMutexLocker lock(&m_mutex);
+	m_file.setFileName(path);
+	if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+		qWarning() << "Unable to open signal log" << path;
+		return false;
+	}
+	m_size = 0;
+	m_capacity = 0;
+	m_emissionCount = 0;
+	m_droppedCount = 0;
+	m_clock.start();
+
+	// reserving the buffer's capacity lets it be
+	// reused for each emission
+	m_buffer.reserve(4096);
+
+	uchar* magic = reserve(LOG_MAGIC_SIZE);
+	if (!magic) {
+		m_file.close();
+		return false;
+	}
+	memcpy(magic, LOG_MAGIC, LOG_MAGIC_SIZE);
+	m_size += LOG_MAGIC_SIZE;
+
+	for (int i=0; i < m_channels.count(); i++) {
+		writeChannel(i);
+	}
+	return true;
+}
+
+void QtSignalRecorder::close()
+{
+	QMutexLocker lock(&m_mutex);
+	if (!m_file.isOpen()) {
+		return;
+	}
+	if (m_map) {
+		m_file.unmap(m_map);
+		m_map = 0;
+	}
+	m_file.resize(m_size);
+	m_file.close();
+	m_capacity = 0;
+}
+
+bool QtSignalRecorder::isOpen() const
+{
+	return m_file.isOpen();
+}
+
+qint64 QtSignalRecorder::emissionCount() const
+{
+	return m_emissionCount;
+}
+
+qint64 QtSignalRecorder::droppedCount() const
+{
+	return m_droppedCount;
+}
+
+bool QtSignalRecorder::record(QObject* sender, const char* signal, const QByteArray& name)
+{
+	int index = qtObjectSignalIndex(sender, signal);
+	if (index < 0) {
+		qWarning() << "No such signal" << signal << "for" << sender;
+		return false;
+	}
+
+	Channel channel;
+	channel.name = name.isEmpty() ? signalName(sender, index) : name;
+	channel.paramTypes = sender->metaObject()->method(index).parameterTypes();
+	if (channel.paramTypes.count() > QTMETACALL_MAX_ARGS) {
+		qWarning() << "Signal" << signal+1 << "has too many arguments to record";
+		return false;
+	}
+	Q_FOREACH(const QByteArray& type, channel.paramTypes) {
+		int typeId = QMetaType::type(type.constData());
+		if (typeId == 0) {
+			qWarning() << "Argument type" << type << "of" << signal+1 << "is not registered";
+			return false;
+		}
+		channel.typeIds << typeId;
+	}
+	channel.codec = QtArgumentCodec(channel.typeIds);
+
+	int channelId;
+	{
+		QMutexLocker lock(&m_mutex);
+		if (m_channels.count() >= MAX_CHANNELS) {
+			qWarning() << "Too many channels in signal log";
+			return false;
+		}
+		channelId = m_channels.count();
+		m_channels << channel;
+		if (m_map) {
+			writeChannel(channelId);
+		}
+	}
+
+	return QtSignalForwarder::connect(sender, signal, this,
+	  QtMetacallAdapter::fromImpl(new QtSignalTools::ChannelInput<QtSignalRecorder>(this, channelId, channel.typeIds)));
+}
+
+uchar* QtSignalRecorder::reserve(qint64 size)
+{
+	if (m_size + size > m_capacity) {
+		qint64 capacity = qMax(m_capacity * 2, qMax(m_size + size, MIN_LOG_CAPACITY));
+		if (m_map) {
+			m_file.unmap(m_map);
+			m_map = 0;
+		}
+		if (!m_file.resize(capacity)) {
+			qWarning() << "Unable to grow signal log" << m_file.fileName();
+			return 0;
+		}
+		m_map = m_file.map(0, capacity);
+		if (!m_map) {
+			qWarning() << "Unable to map signal log" << m_file.fileName();
+			return 0;
+		}
+		m_capacity = capacity;
+	}
+	return m_map + m_size;
+}
+
+void QtSignalRecorder::writeChannel(int channelId)
+{
+	const Channel& channel = m_channels.at(channelId);
+
+	// channel records are written to a separate buffer, as clearing
+	// m_buffer would release the capacity reserved for emissions
+	QByteArray payload;
+	{
+		QDataStream stream(&payload, QIODevice::WriteOnly);
+		stream.setVersion(LOG_STREAM_VERSION);
+		stream << channel.name << channel.paramTypes;
+	}
+
+	uchar* dest = reserve(recordSize(payload.size()));
+	if (!dest) {
+		return;
+	}
+	LogRecordHeader header;
+	header.payloadSize = payload.size();
+	header.kind = ChannelRecord;
+	header.channel = channelId;
+	header.timestamp = m_clock.nsecsElapsed();
+	memcpy(dest, &header, sizeof(header));
+	memcpy(dest + sizeof(header), payload.constData(), payload.size());
+	m_size += recordSize(payload.size());
+}
+
+void QtSignalRecorder::append(int channelId, const QGenericArgument* args, int count)
+{
+	QMutexLocker lock(&m_mutex);
+	if (!m_map) {
+		return;
+	}
+
+	const Channel& channel = m_channels.at(channelId);
+	m_buffer.resize(0);
+	if (count < channel.typeIds.count() || !channel.codec.encode(&m_buffer, args, count)) {
+		++m_droppedCount;
+		return;
+	}
+
+	uchar* dest = reserve(recordSize(m_buffer.size()));
+	if (!dest) {
+		++m_droppedCount;
+		return;
+	}
+	LogRecordHeader header;
+	header.payloadSize = m_buffer.size();
+	header.kind = EmissionRecord;
+	header.channel = channelId;
+	header.timestamp = m_clock.nsecsElapsed();
+	memcpy(dest, &header, sizeof(header));
+	memcpy(dest + sizeof(header), m_buffer.constData(), m_buffer.size());
+	m_size += recordSize(m_buffer.size());
+	++m_emissionCount;
+}
+
+QtSignalReplayer::QtSignalReplayer()
+	: m_map(0)
+	, m_size(0)
+	, m_emissionCount(0)
+{
+}
+
+QtSignalReplayer::~QtSignalReplayer()
+{
+	close();
+}
+
+bool QtSignalReplayer::open(const QString& path)
+{
+	close();
+
+	m_file.setFileName(path);
+	if (!m_file.open(QIODevice::ReadOnly)) {
+		qWarning() << "Unable to open signal log" << path;
+		return false;
+	}
+	m_size = m_file.size();
+	if (m_size > 0) {
+		m_map = m_file.map(0, m_size);
+	}
+	if (!m_map || m_size < LOG_MAGIC_SIZE || memcmp(m_map, LOG_MAGIC, LOG_MAGIC_SIZE) != 0) {
+		qWarning() << "Invalid signal log" << path;
+		close();
+		return false;
+	}
+
+	// read the channel definitions and check that
+	// the records lie within the file
+	qint64 offset = LOG_MAGIC_SIZE;
+	while (offset + qint64(sizeof(LogRecordHeader)) <= m_size) {
+		LogRecordHeader header;
+		memcpy(&header, m_map + offset, sizeof(header));
+		const char* payload = reinterpret_cast<const char*>(m_map + offset + sizeof(header));
+		if (offset + qint64(sizeof(header)) + header.payloadSize > m_size) {
+			break;
+		}
+
+		if (header.kind == ChannelRecord) {
+			if (header.channel != m_channels.count()) {
+				break;
+			}
+			QDataStream stream(QByteArray::fromRawData(payload, header.payloadSize));
+			stream.setVersion(LOG_STREAM_VERSION);
+			Channel channel;
+			stream >> channel.name >> channel.paramTypes;
+			Q_FOREACH(const QByteArray& type, channel.paramTypes) {
+				channel.typeIds << QMetaType::type(type.constData());
+			}
+			channel.codec = QtArgumentCodec(channel.typeIds);
+			m_channels << channel;
+		} else if (header.kind == EmissionRecord) {
+			if (header.channel >= m_channels.count()) {
+				break;
+			}
+			++m_emissionCount;
+		}
+		offset += recordSize(header.payloadSize);
+	}
+
+	// ignore any incomplete or invalid records at the end of the log,
+	// eg. if the recording process exited without closing it
+	if (offset != m_size) {
+		qWarning() << "Signal log" << path << "is truncated at offset" << offset;
+		m_size = offset;
+	}
+	return true;
+}
+
+void QtSignalReplayer::close()
+{
+	if (m_map) {
+		m_file.unmap(const_cast<uchar*>(m_map));
+		m_map = 0;
+	}
+	m_file.close();
+	m_size = 0;
+	m_emissionCount = 0;
+	m_channels.clear();
+}
+
+QList<QByteArray> QtSignalReplayer::channels() const
+{
+	QList<QByteArray> names;
+	Q_FOREACH(const Channel& channel, m_channels) {
+		names << channel.name;
+	}
+	return names;
+}
+
+QList<QByteArray> QtSignalReplayer::paramTypes(const QByteArray& channel) const
+{
+	int index = findChannel(channel);
+	if (index < 0) {
+		return QList<QByteArray>();
+	}
+	return m_channels.at(index).paramTypes;
+}
+
+qint64 QtSignalReplayer::emissionCount() const
+{
+	return m_emissionCount;
+}
+
+int QtSignalReplayer::findChannel(const QByteArray& name) const
+{
+	for (int i=0; i < m_channels.count(); i++) {
+		if (m_channels.at(i).name == name) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool QtSignalReplayer::bind(const QByteArray& name, const QtMetacallAdapter& callback)
+{
+	int index = findChannel(name);
+	if (index < 0) {
+		qWarning() << "No such channel" << name << "in signal log";
+		return false;
+	}
+
+	Channel& channel = m_channels[index];
+	int receiverArgTypes[QTMETACALL_MAX_ARGS];
+	int receiverArgCount = callback.getArgTypes(receiverArgTypes);
+	for (int i=0; i < receiverArgCount; i++) {
+		if (i >= channel.typeIds.count() || channel.typeIds.at(i) != receiverArgTypes[i]) {
+			qWarning() << "Callback arguments do not match channel" << name;
+			return false;
+		}
+	}
+	channel.callback = callback;
+	return true;
+}
+
+qint64 QtSignalReplayer::replay(Pacing pacing)
+{
+	QElapsedTimer clock;
+	clock.start();
+	qint64 firstTimestamp = -1;
+	qint64 invokeCount = 0;
+
+	// the values are reused between emissions, so that decoding
+	// into them can reuse their storage
+	QVariant values[QTMETACALL_MAX_ARGS];
+
+	qint64 offset = LOG_MAGIC_SIZE;
+	while (offset < m_size) {
+		LogRecordHeader header;
+		memcpy(&header, m_map + offset, sizeof(header));
+		const char* payload = reinterpret_cast<const char*>(m_map + offset + sizeof(header));
+		offset += recordSize(header.payloadSize);
+
+		if (header.kind != EmissionRecord) {
+			continue;
+		}
+		const Channel& channel = m_channels.at(header.channel);
+		if (channel.callback.isNull() || channel.typeIds.count() > QTMETACALL_MAX_ARGS) {
+			continue;
+		}
+
+		if (pacing == RecordedPacing) {
+			if (firstTimestamp < 0) {
+				firstTimestamp = header.timestamp;
+			}
+			qint64 waitMs = (header.timestamp - firstTimestamp - clock.nsecsElapsed()) / 1000000;
+			if (waitMs > 0) {
+				sleepMs(static_cast<int>(waitMs));
+			}
+		}
+
+		int payloadOffset = 0;
+		if (!channel.codec.decode(payload, header.payloadSize, &payloadOffset, values)) {
+			qWarning() << "Unable to read arguments for channel" << channel.name;
+			continue;
+		}
+		QGenericArgument args[QTMETACALL_MAX_ARGS];
+		int argCount = qMin(channel.typeIds.count(), QTMETACALL_MAX_ARGS);
+		for (int i=0; i < argCount; i++) {
+			args[i] = QGenericArgument(channel.paramTypes.at(i).constData(), values[i].constData());
+		}
+
+		channel.callback.invoke(args, argCount);
+		++invokeCount;
+	}
+	return invokeCount;
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "QtArgumentCodec.h"
+#include "QtMetacallAdapter.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+namespace QtSignalTools
+{
+template <class Target> struct ChannelInput;
+}
+
+/** QtSignalRecorder records the emissions of chosen signals to an append-only
+ * binary log, which QtSignalReplayer can later use to invoke callbacks
+ * with the same arguments.
+ *
+ * This can be used to capture real traffic in a running application and
+ * replay it offline, eg. to reproduce a problem or to benchmark changes
+ * to the handlers for the signals.
+ *
+ * Each recorded signal is a 'channel' in the log.  For each emission, the
+ * recorder writes the channel, a timestamp and the signal's arguments, which
+ * are serialized by QtArgumentCodec.  The argument types must be registered
+ * with qRegisterMetaType<T>() and, for types which the codec does not handle
+ * directly, qRegisterMetaTypeStreamOperators<T>().
+ *
+ * The log is written to a memory-mapped file which grows as needed, so
+ * recording an emission normally does not involve a system call.
+ *
+ * Example usage:
+ *
+ *  QtSignalRecorder recorder;
+ *  recorder.open("session.qstlog");
+ *  recorder.record(model, SIGNAL(dataChanged(QModelIndex,QModelIndex)), "dataChanged");
+ *  ...
+ *  recorder.close();
+ *
+ *  QtSignalReplayer replayer;
+ *  replayer.open("session.qstlog");
+ *  replayer.bind("dataChanged", QtCallback(view, SLOT(dataChanged(QModelIndex,QModelIndex))));
+ *  replayer.replay(QtSignalReplayer::RecordedPacing);
+ *
+ * Emissions are recorded through QtSignalForwarder bindings, for which the recorder
+ * is the context object, so recording stops when the recorder is destroyed.
+ */
+class QtSignalRecorder : public QObject
+{
+	// no Q_OBJECT macro here - the recorder has no signals or slots
+	// of its own
+
+	public:
+		QtSignalRecorder(QObject* parent = 0);
+		virtual ~QtSignalRecorder();
+
+		/** Creates or truncates the log file at @p path and starts recording */
+		bool open(const QString& path);
+
+		/** Stops recording and truncates the log file to the size of
+		 * the recorded data.
+		 */
+		void close();
+
+		bool isOpen() const;
+
+		/** Records emissions of @p signal from @p sender in a channel called
+		 * @p name.  If @p name is empty, the channel is named after the sender's
+		 * class and the signal, eg. "QSlider::valueChanged(int)".
+		 *
+		 * Channels can be added before or after the log is opened.  Returns
+		 * false if the signal does not exist or its argument types are not
+		 * registered.
+		 */
+		bool record(QObject* sender, const char* signal, const QByteArray& name = QByteArray());
+
+		/** Returns the number of emissions recorded since the log was opened */
+		qint64 emissionCount() const;
+
+		/** Returns the number of emissions which could not be recorded
+		 * because an argument could not be serialized.
+		 */
+		qint64 droppedCount() const;
+
+	private:
+		struct Channel
+		{
+			QByteArray name;
+			QList<QByteArray> paramTypes;
+			QList<int> typeIds;
+			QtArgumentCodec codec;
+		};
+
+		// adapter which passes the arguments of a
+		// recorded signal to append()
+		friend struct QtSignalTools::ChannelInput<QtSignalRecorder>;
+
+		void writeChannel(int channel);
+		void append(int channel, const QGenericArgument* args, int count);
+
+		// returns a pointer to @p size bytes at the end of the log,
+		// growing the file if necessary
+		uchar* reserve(qint64 size);
+
+		QMutex m_mutex;
+		QList<Channel> m_channels;
+		QFile m_file;
+		uchar* m_map;
+		qint64 m_capacity;
+		qint64 m_size;
+		qint64 m_emissionCount;
+		qint64 m_droppedCount;
+		QElapsedTimer m_clock;
+
+		// encoded arguments of the emission being recorded.  Its capacity
+		// is reserved in open() and kept from one emission to the next.
+		QByteArray m_buffer;
+};
+
+/** QtSignalReplayer reads a log written by QtSignalRecorder and invokes
+ * the callbacks bound to its channels with the recorded arguments.
+ */
+class QtSignalReplayer
+{
+	public:
+		enum Pacing
+		{
+			/** Invoke the callbacks as quickly as possible */
+			FullSpeed,
+			/** Wait between invocations so that they happen at the
+			 * same intervals as the recorded emissions
+			 */
+			RecordedPacing
+		};
+
+		QtSignalReplayer();
+		~QtSignalReplayer();
+
+		/** Opens and maps the log file at @p path.  Returns false if
+		 * the file cannot be read or is not a valid log.
+		 */
+		bool open(const QString& path);
+		void close();
+
+		/** Returns the names of the channels in the log */
+		QList<QByteArray> channels() const;
+
+		/** Returns the argument types of the signal recorded in @p channel */
+		QList<QByteArray> paramTypes(const QByteArray& channel) const;
+
+		/** Returns the number of emissions in the log */
+		qint64 emissionCount() const;
+
+		/** Sets the callback to invoke for emissions recorded in @p channel.
+		 * The callback's arguments must match the recorded signal's arguments,
+		 * as for QtSignalForwarder::connect().
+		 */
+		bool bind(const QByteArray& channel, const QtMetacallAdapter& callback);
+
+		/** Invokes the bound callbacks for each of the emissions in the log, in the order
+		 * that they were recorded.  Emissions in channels without a callback are skipped.
+		 *
+		 * Returns the number of callbacks invoked.
+		 */
+		qint64 replay(Pacing pacing = FullSpeed);
+
+	private:
+		Q_DISABLE_COPY(QtSignalReplayer)
+
+		struct Channel
+		{
+			QByteArray name;
+			QList<QByteArray> paramTypes;
+			QList<int> typeIds;
+			QtArgumentCodec codec;
+			QtMetacallAdapter callback;
+		};
+
+		// returns the index of the channel called @p name, or -1
+		int findChannel(const QByteArray& name) const;
+
+		QFile m_file;
+		const uchar* m_map;
+		qint64 m_size;
+		qint64 m_emissionCount;
+		QList<Channel> m_channels;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+// internal helpers shared by the library's implementation files.
+// This header is not part of the public API.
+
+#include "QtMetacallAdapter.h"
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QList>
+
+class QObject;
+
+// returns the method index of @p signal, a signature produced by
+// the SIGNAL() macro, in @p object's class, or -1 if there is no
+// such signal.  This is defined in QtSignalForwarder.cpp.
+int qtObjectSignalIndex(const QObject* object, const char* signal);
+
+namespace QtSignalTools
+{
+
+// atomic load and store with acquire and release ordering,
+// which Qt 4's QAtomicInt does not provide directly
+inline int loadAcquire(const QAtomicInt& value)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	return value.loadAcquire();
+#else
+	return value;
+#endif
+}
+
+inline void storeRelease(QAtomicInt& value, int newValue)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	value.storeRelease(newValue);
+#else
+	value.fetchAndStoreRelease(newValue);
+#endif
+}
+
+// adapter which passes the arguments of a signal to Target::append(),
+// for classes which forward emissions of several signals to numbered
+// channels.  Target must declare ChannelInput<Target> as a friend.
+template <class Target>
+struct ChannelInput : public QtMetacallAdapterImplIface
+{
+	ChannelInput(Target* _target, int _channel, const QList<int>& _typeIds)
+		: target(_target)
+		, channel(_channel)
+		, typeIds(_typeIds)
+	{}
+
+	virtual bool invoke(const QGenericArgument* args, int count) const
+	{
+		target->append(channel, args, count);
+		return true;
+	}
+
+	virtual int getArgTypes(QtMetacallArgsArray args) const
+	{
+		int count = qMin(typeIds.count(), QTMETACALL_MAX_ARGS);
+		for (int i=0; i < count; i++) {
+			args[i] = typeIds.at(i);
+		}
+		return count;
+	}
+
+	virtual int estimatedSize() const { return sizeof(*this); }
+
+	// the target is the context of the binding, so the
+	// binding is removed when the target is destroyed
+	Target* target;
+	int channel;
+	QList<int> typeIds;
+};
+
+}
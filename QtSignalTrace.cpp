@@ -0,0 +1,355 @@
+#include "QtSignalTrace.h"
+
+#include "QtSignalToolsPrivate.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QList>
+#include <QtCore/QMetaMethod>
+#include <QtCore/QMetaObject>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QThread>
+#include <QtCore/QThreadStorage>
+#include <QtCore/QVector>
+
+QAtomicInt QtSignalTrace::s_enabled;
+
+namespace
+{
+
+const int DEFAULT_BUFFER_SIZE = 16384;
+const int MIN_BUFFER_SIZE = 16;
+
+struct TraceRecord
+{
+	// nanoseconds since the trace clock was started
+	qint64 timestamp;
+	const QMetaObject* metaObject;
+	const void* callback;
+	int detail;
+	char phase;
+	char category;
+};
+
+using QtSignalTools::loadAcquire;
+using QtSignalTools::storeRelease;
+
+// ring buffer of trace records written by a single thread.
+//
+// A record is published by incrementing 'head' after it has been written,
+// so other threads can copy the buffer without locking.  'head' is never reset
+// and is allowed to wrap around.  The capacity is a power of two, so that
+// record indexes remain valid when it does.
+struct TraceBuffer
+{
+	TraceBuffer(int capacity, int _threadId, const QString& _threadName)
+		: records(new TraceRecord[capacity])
+		, mask(capacity - 1)
+		, threadId(_threadId)
+		, threadName(_threadName)
+		, clearedAt(0)
+	{}
+
+	~TraceBuffer()
+	{
+		delete[] records;
+	}
+
+	uint capacity() const
+	{
+		return mask + 1;
+	}
+
+	// copies the records written since index 'from'.  Records which the
+	// writer overwrites while they are being copied are discarded.
+	QVector<TraceRecord> copyRecords(uint from) const
+	{
+		uint end = loadAcquire(head);
+		uint start = end - qMin(end - from, capacity());
+
+		QVector<TraceRecord> result;
+		result.reserve(end - start);
+		for (uint i = start; i != end; i++) {
+			result << records[i & mask];
+		}
+
+		// the record at index 'newHead' may be partially written, so
+		// copies from its slot or any slot written after the copy
+		// began are invalid
+		uint newHead = loadAcquire(head);
+		int invalidCount = 0;
+		for (uint i = start; i != end && newHead - i >= capacity(); i++) {
+			++invalidCount;
+		}
+		result.remove(0, invalidCount);
+		return result;
+	}
+
+	TraceRecord* records;
+	uint mask;
+	QAtomicInt head;
+	int threadId;
+	QString threadName;
+
+	// value of 'head' when QtSignalTrace::clear() was last called.
+	// Guarded by the registry mutex.
+	uint clearedAt;
+
+private:
+	Q_DISABLE_COPY(TraceBuffer)
+};
+
+// list of buffers for all threads which have recorded events.
+// Buffers are kept after their thread exits so that the
+// thread's events can still be exported.
+struct TraceRegistry
+{
+	TraceRegistry()
+		: bufferSize(DEFAULT_BUFFER_SIZE)
+		, nextThreadId(1)
+	{
+		clock.start();
+	}
+
+	QMutex mutex;
+	QList<QSharedPointer<TraceBuffer> > buffers;
+	int bufferSize;
+	int nextThreadId;
+	QElapsedTimer clock;
+};
+
+Q_GLOBAL_STATIC(TraceRegistry, traceRegistry)
+Q_GLOBAL_STATIC(QThreadStorage<QSharedPointer<TraceBuffer> >, threadTraceBuffer)
+
+TraceBuffer* currentThreadBuffer()
+{
+	QSharedPointer<TraceBuffer>& buffer = threadTraceBuffer()->localData();
+	if (!buffer) {
+		TraceRegistry* registry = traceRegistry();
+		QMutexLocker lock(&registry->mutex);
+
+		int threadId = registry->nextThreadId++;
+		QThread* thread = QThread::currentThread();
+		QString threadName = thread->objectName();
+		if (threadName.isEmpty()) {
+			if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+				threadName = "Main Thread";
+			} else {
+				threadName = QString("Thread %1").arg(threadId);
+			}
+		}
+		buffer = QSharedPointer<TraceBuffer>(new TraceBuffer(registry->bufferSize, threadId, threadName));
+		registry->buffers << buffer;
+	}
+	return buffer.data();
+}
+
+QByteArray jsonString(const QString& text)
+{
+	QByteArray result = "\"";
+	QByteArray utf8 = text.toUtf8();
+	for (int i=0; i < utf8.count(); i++) {
+		char ch = utf8.at(i);
+		if (ch == '"' || ch == '\\') {
+			result += '\\';
+			result += ch;
+		} else if (static_cast<uchar>(ch) < 0x20) {
+			result += "\\u00";
+			result += QByteArray::number(static_cast<int>(ch), 16).rightJustified(2, '0');
+		} else {
+			result += ch;
+		}
+	}
+	result += '"';
+	return result;
+}
+
+QByteArray recordName(const TraceRecord& record)
+{
+	if (record.category == QtSignalTrace::DelayedCall) {
+		return "delayedCall";
+	}
+	if (!record.metaObject) {
+		return "(unknown)";
+	}
+
+	QtSignalTrace::Category category = static_cast<QtSignalTrace::Category>(record.category);
+	QByteArray separator = category == QtSignalTrace::EventDispatch ? " " : "::";
+	return record.metaObject->className() + separator +
+	  QtSignalTrace::detailName(category, record.metaObject, record.detail);
+}
+
+const char* categoryName(char category)
+{
+	switch (category) {
+	case QtSignalTrace::SignalDispatch:
+		return "signal";
+	case QtSignalTrace::EventDispatch:
+		return "event";
+	case QtSignalTrace::CallbackInvoke:
+		return "callback";
+	case QtSignalTrace::DelayedCall:
+		return "timer";
+	}
+	return "unknown";
+}
+
+QByteArray pointerString(const void* pointer)
+{
+	return "\"0x" + QByteArray::number(reinterpret_cast<quintptr>(pointer), 16) + "\"";
+}
+
+}
+
+QByteArray QtSignalTrace::detailName(Category category, const QMetaObject* metaObject, int detail)
+{
+	switch (category) {
+	case EventDispatch:
+		return "event " + QByteArray::number(detail);
+	case DelayedCall:
+		return "delayedCall";
+	default:
+		break;
+	}
+
+	if (!metaObject || detail < 0 || detail >= metaObject->methodCount()) {
+		return QByteArray::number(detail);
+	}
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	return metaObject->method(detail).methodSignature();
+#else
+	return metaObject->method(detail).signature();
+#endif
+}
+
+void QtSignalTrace::setEnabled(bool enabled)
+{
+	// make sure the trace clock is started before
+	// any events are recorded
+	traceRegistry();
+	storeRelease(s_enabled, enabled ? 1 : 0);
+}
+
+void QtSignalTrace::setBufferSize(int eventCount)
+{
+	int size = MIN_BUFFER_SIZE;
+	while (size < eventCount) {
+		size *= 2;
+	}
+	TraceRegistry* registry = traceRegistry();
+	QMutexLocker lock(&registry->mutex);
+	registry->bufferSize = size;
+}
+
+int QtSignalTrace::bufferSize()
+{
+	TraceRegistry* registry = traceRegistry();
+	QMutexLocker lock(&registry->mutex);
+	return registry->bufferSize;
+}
+
+void QtSignalTrace::clear()
+{
+	TraceRegistry* registry = traceRegistry();
+	QMutexLocker lock(&registry->mutex);
+	Q_FOREACH(const QSharedPointer<TraceBuffer>& buffer, registry->buffers) {
+		buffer->clearedAt = loadAcquire(buffer->head);
+	}
+}
+
+void QtSignalTrace::record(char phase, Category category, const QObject* object, int detail,
+	const void* callback)
+{
+	TraceBuffer* buffer = currentThreadBuffer();
+
+	// only this thread writes to the buffer, so a relaxed
+	// read of 'head' would suffice here
+	uint head = loadAcquire(buffer->head);
+	TraceRecord& entry = buffer->records[head & buffer->mask];
+	entry.timestamp = traceRegistry()->clock.nsecsElapsed();
+	entry.metaObject = object ? object->metaObject() : 0;
+	entry.callback = callback;
+	entry.detail = detail;
+	entry.phase = phase;
+	entry.category = static_cast<char>(category);
+	storeRelease(buffer->head, head + 1);
+}
+
+QByteArray QtSignalTrace::exportChromeTrace()
+{
+	TraceRegistry* registry = traceRegistry();
+	QList<QSharedPointer<TraceBuffer> > buffers;
+	QList<uint> clearedAt;
+	{
+		QMutexLocker lock(&registry->mutex);
+		buffers = registry->buffers;
+		Q_FOREACH(const QSharedPointer<TraceBuffer>& buffer, buffers) {
+			clearedAt << buffer->clearedAt;
+		}
+	}
+
+	QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+	QByteArray json = "{\"traceEvents\":[";
+	bool firstEvent = true;
+
+	for (int i=0; i < buffers.count(); i++) {
+		const TraceBuffer* buffer = buffers.at(i).data();
+		QByteArray tid = QByteArray::number(buffer->threadId);
+
+		if (!firstEvent) {
+			json += ",\n";
+		}
+		firstEvent = false;
+		json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid +
+		  ",\"args\":{\"name\":" + jsonString(buffer->threadName) + "}}";
+
+		// the oldest records in the buffer may be the ends of dispatches whose
+		// beginnings have been overwritten.  Those are skipped.
+		int depth = 0;
+		Q_FOREACH(const TraceRecord& record, buffer->copyRecords(clearedAt.at(i))) {
+			if (record.phase == 'E') {
+				if (depth == 0) {
+					continue;
+				}
+				--depth;
+			} else if (record.phase == 'B') {
+				++depth;
+			}
+
+			json += ",\n{\"ph\":\"";
+			json += record.phase;
+			json += "\",\"pid\":" + pid + ",\"tid\":" + tid +
+			  ",\"ts\":" + QByteArray::number(record.timestamp / 1000.0, 'f', 3);
+			if (record.phase != 'E') {
+				json += ",\"name\":" + jsonString(QString::fromLatin1(recordName(record))) +
+				  ",\"cat\":\"" + categoryName(record.category) + "\"" +
+				  ",\"args\":{\"callback\":" + pointerString(record.callback);
+				if (record.category == DelayedCall) {
+					json += ",\"delay_ms\":" + QByteArray::number(record.detail);
+				}
+				json += "}";
+			}
+			if (record.phase == 'i') {
+				json += ",\"s\":\"t\"";
+			}
+			json += "}";
+		}
+	}
+
+	json += "],\"displayTimeUnit\":\"ms\"}\n";
+	return json;
+}
+
+bool QtSignalTrace::saveChromeTrace(const QString& path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		return false;
+	}
+	QByteArray json = exportChromeTrace();
+	return file.write(json) == json.size();
+}
+
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+class QObject;
+struct QMetaObject;
+
+/** QtSignalTrace records the dispatch of signals and events by QtSignalForwarder,
+ * invocations of QtCallback objects and scheduling of delayed calls.  The recorded
+ * events can be exported in the Chrome trace event format and viewed
+ * in chrome://tracing or https://ui.perfetto.dev .
+ *
+ * Tracing is disabled by default.  When disabled, the cost at each dispatch site
+ * is a single atomic load.  When enabled, each thread records into its own
+ * fixed-size ring buffer without taking any locks.  Once a thread's buffer is full,
+ * its oldest events are overwritten, so the exported trace always covers the
+ * most recent activity on each thread.
+ *
+ * Each record stores only the QMetaObject of the sender or receiver, the signal index,
+ * method index or event type and the identity of the callback.  Class and signal
+ * names are looked up when the trace is exported.
+ *
+ * Example usage, saving a trace when the UI stalls:
+ *
+ *  QtSignalTrace::setEnabled(true);
+ *  ...
+ *  void Watchdog::stallDetected()
+ *  {
+ *    QtSignalTrace::saveChromeTrace(QDir::temp().filePath("dispatch-trace.json"));
+ *  }
+ */
+class QtSignalTrace
+{
+	public:
+		enum Category
+		{
+			/** Invocation of a QtSignalForwarder signal binding */
+			SignalDispatch,
+			/** Invocation of a QtSignalForwarder event binding */
+			EventDispatch,
+			/** Invocation of a QtCallback */
+			CallbackInvoke,
+			/** A call scheduled with QtSignalForwarder::delayedCall() */
+			DelayedCall
+		};
+
+		static void setEnabled(bool enabled);
+		static bool isEnabled()
+		{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+			return s_enabled.loadAcquire() != 0;
+#else
+			return s_enabled != 0;
+#endif
+		}
+
+		/** Sets the number of events which each thread's buffer can hold.
+		 * This is rounded up to a power of two and only affects buffers for
+		 * threads which have not yet recorded any events.  Defaults to 16384.
+		 */
+		static void setBufferSize(int eventCount);
+		static int bufferSize();
+
+		/** Discards all events recorded so far. */
+		static void clear();
+
+		/** Returns the events recorded by all threads as a Chrome trace
+		 * event format JSON document.
+		 */
+		static QByteArray exportChromeTrace();
+
+		/** Writes the output of exportChromeTrace() to @p path. */
+		static bool saveChromeTrace(const QString& path);
+
+		/** Returns a readable name for the signal or method with index @p detail
+		 * or the event with type @p detail, depending on @p category.
+		 */
+		static QByteArray detailName(Category category, const QMetaObject* metaObject, int detail);
+
+		/** Records an event of zero duration if tracing is enabled. */
+		static void instant(Category category, const QObject* object, int detail,
+			const void* callback)
+		{
+			if (isEnabled()) {
+				record('i', category, object, detail, callback);
+			}
+		}
+
+		/** Records the start of a dispatch when constructed and the end
+		 * when destroyed, if tracing is enabled.
+		 *
+		 * @p object is the sender or receiver, @p detail is the signal
+		 * or method index or the event type and @p callback identifies
+		 * the function being invoked (see QtMetacallAdapter::identity()).
+		 */
+		class Scope
+		{
+			public:
+				Scope(Category category, const QObject* object, int detail,
+					const void* callback)
+					: m_category(category)
+					, m_active(isEnabled())
+				{
+					if (m_active) {
+						record('B', category, object, detail, callback);
+					}
+				}
+
+				~Scope()
+				{
+					if (m_active) {
+						record('E', m_category, 0, -1, 0);
+					}
+				}
+
+			private:
+				Q_DISABLE_COPY(Scope)
+
+				Category m_category;
+				bool m_active;
+		};
+
+	private:
+		static void record(char phase, Category category, const QObject* object,
+			int detail, const void* callback);
+
+		static QAtomicInt s_enabled;
+};
+
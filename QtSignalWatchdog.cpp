@@ -0,0 +1,230 @@
+#include "QtSignalWatchdog.h"
+
+#include "FunctionUtils.h"
+#include "QtSignalToolsPrivate.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMetaObject>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+
+#ifndef QST_THREAD_LOCAL
+#include <QtCore/QThreadStorage>
+#endif
+
+QAtomicInt QtSignalWatchdog::s_enabled;
+
+namespace
+{
+
+const int DEFAULT_GUI_THREAD_THRESHOLD = 8000;
+const int DEFAULT_THRESHOLD = 50000;
+const int DEFAULT_MAX_REPORTS = 100;
+const int DEFAULT_SAMPLE_INTERVAL = 32;
+
+using QtSignalTools::loadAcquire;
+using QtSignalTools::storeRelease;
+
+struct WatchdogState
+{
+	WatchdogState()
+		: guiThreadThreshold(DEFAULT_GUI_THREAD_THRESHOLD)
+		, threshold(DEFAULT_THRESHOLD)
+		, sampleInterval(DEFAULT_SAMPLE_INTERVAL)
+		, maxReports(DEFAULT_MAX_REPORTS)
+		, droppedReports(0)
+	{
+		clock.start();
+	}
+
+	QElapsedTimer clock;
+
+	// settings are read on every sampled dispatch,
+	// so they are stored in atomics rather than guarded
+	// by the mutex
+	QAtomicInt guiThreadThreshold;
+	QAtomicInt threshold;
+	QAtomicInt sampleInterval;
+
+	QMutex mutex;
+	int maxReports;
+	QList<QtSignalWatchdog::Report> reports;
+	quint64 droppedReports;
+};
+
+Q_GLOBAL_STATIC(WatchdogState, watchdogState)
+
+// per-thread counters used to pick which dispatches to sample, so that
+// threads dispatching at the same time do not contend for one counter.
+// Wrapping around is harmless.
+#ifdef QST_THREAD_LOCAL
+QST_THREAD_LOCAL uint dispatchCounter = 0;
+
+inline uint nextDispatch()
+{
+	return dispatchCounter++;
+}
+#else
+Q_GLOBAL_STATIC(QThreadStorage<uint>, dispatchCounter)
+
+inline uint nextDispatch()
+{
+	return dispatchCounter()->localData()++;
+}
+#endif
+
+bool isGuiThread()
+{
+	QCoreApplication* app = QCoreApplication::instance();
+	return app && QThread::currentThread() == app->thread();
+}
+
+}
+
+void QtSignalWatchdog::setEnabled(bool enabled)
+{
+	// make sure the clock is started before any
+	// dispatches are timed
+	watchdogState();
+	storeRelease(s_enabled, enabled ? 1 : 0);
+}
+
+void QtSignalWatchdog::setGuiThreadThreshold(int usecs)
+{
+	storeRelease(watchdogState()->guiThreadThreshold, usecs);
+}
+
+int QtSignalWatchdog::guiThreadThreshold()
+{
+	return loadAcquire(watchdogState()->guiThreadThreshold);
+}
+
+void QtSignalWatchdog::setThreshold(int usecs)
+{
+	storeRelease(watchdogState()->threshold, usecs);
+}
+
+int QtSignalWatchdog::threshold()
+{
+	return loadAcquire(watchdogState()->threshold);
+}
+
+void QtSignalWatchdog::setSampleInterval(int interval)
+{
+	storeRelease(watchdogState()->sampleInterval, qMax(interval, 1));
+}
+
+int QtSignalWatchdog::sampleInterval()
+{
+	return loadAcquire(watchdogState()->sampleInterval);
+}
+
+void QtSignalWatchdog::setMaxReports(int count)
+{
+	WatchdogState* state = watchdogState();
+	QMutexLocker lock(&state->mutex);
+	state->maxReports = qMax(count, 0);
+	while (state->reports.count() > state->maxReports) {
+		state->reports.removeFirst();
+		++state->droppedReports;
+	}
+}
+
+int QtSignalWatchdog::maxReports()
+{
+	WatchdogState* state = watchdogState();
+	QMutexLocker lock(&state->mutex);
+	return state->maxReports;
+}
+
+QList<QtSignalWatchdog::Report> QtSignalWatchdog::reports()
+{
+	WatchdogState* state = watchdogState();
+	QMutexLocker lock(&state->mutex);
+	return state->reports;
+}
+
+QList<QtSignalWatchdog::Report> QtSignalWatchdog::takeReports()
+{
+	WatchdogState* state = watchdogState();
+	QMutexLocker lock(&state->mutex);
+	QList<Report> reports = state->reports;
+	state->reports.clear();
+	return reports;
+}
+
+quint64 QtSignalWatchdog::droppedReportCount()
+{
+	WatchdogState* state = watchdogState();
+	QMutexLocker lock(&state->mutex);
+	return state->droppedReports;
+}
+
+void QtSignalWatchdog::clear()
+{
+	WatchdogState* state = watchdogState();
+	QMutexLocker lock(&state->mutex);
+	state->reports.clear();
+	state->droppedReports = 0;
+}
+
+void QtSignalWatchdog::Scope::begin(QtSignalTrace::Category category, const QObject* object, int detail,
+	const void* callback)
+{
+	WatchdogState* state = watchdogState();
+	int interval = loadAcquire(state->sampleInterval);
+	if (interval > 1 && nextDispatch() % interval != 0) {
+		return;
+	}
+
+	// the object may be destroyed by the callback, so its class
+	// is recorded up front
+	m_category = category;
+	m_metaObject = object ? object->metaObject() : 0;
+	m_detail = detail;
+	m_callback = callback;
+	m_startTime = state->clock.nsecsElapsed();
+}
+
+void QtSignalWatchdog::Scope::end()
+{
+	WatchdogState* state = watchdogState();
+	qint64 durationUsecs = (state->clock.nsecsElapsed() - m_startTime) / 1000;
+
+	// compare against the lower of the two thresholds first, so that
+	// the current thread only needs to be looked up for slow callbacks
+	int guiThreshold = loadAcquire(state->guiThreadThreshold);
+	int otherThreshold = loadAcquire(state->threshold);
+	if (durationUsecs < qMin(guiThreshold, otherThreshold)) {
+		return;
+	}
+	bool guiThread = isGuiThread();
+	if (durationUsecs < (guiThread ? guiThreshold : otherThreshold)) {
+		return;
+	}
+
+	Report report;
+	report.category = m_category;
+	if (m_metaObject) {
+		report.senderClass = m_metaObject->className();
+	}
+	report.name = QtSignalTrace::detailName(m_category, m_metaObject, m_detail);
+	report.callback = m_callback;
+	report.detail = m_detail;
+	report.durationUsecs = durationUsecs;
+	report.guiThread = guiThread;
+
+	QMutexLocker lock(&state->mutex);
+	if (state->maxReports == 0) {
+		++state->droppedReports;
+		return;
+	}
+	if (state->reports.count() >= state->maxReports) {
+		state->reports.removeFirst();
+		++state->droppedReports;
+	}
+	state->reports << report;
+}
+
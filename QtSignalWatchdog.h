@@ -0,0 +1,153 @@
+#pragma once
+
+#include "QtSignalTrace.h"
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+
+struct QMetaObject;
+class QObject;
+
+/** QtSignalWatchdog times the callbacks invoked by QtSignalForwarder for signal
+ * and event bindings and keeps a report of those which take longer than a threshold.
+ *
+ * Separate thresholds can be set for the main (GUI) thread, where a slow callback
+ * delays painting and input handling, and for other threads.
+ *
+ * To keep the overhead low, only one in every sampleInterval() dispatches is timed.
+ * Dispatches are counted separately in each thread.
+ * When the watchdog is disabled, the cost at each dispatch site is a single
+ * atomic load.
+ *
+ * Example usage, logging handlers which take longer than 8ms on the GUI thread:
+ *
+ *  QtSignalWatchdog::setGuiThreadThreshold(8000);
+ *  QtSignalWatchdog::setEnabled(true);
+ *  ...
+ *  Q_FOREACH(const QtSignalWatchdog::Report& report, QtSignalWatchdog::takeReports()) {
+ *    qWarning() << "Slow handler for" << report.senderClass << report.name
+ *      << report.durationUsecs << "us";
+ *  }
+ */
+class QtSignalWatchdog
+{
+	public:
+		/** Details of a callback which exceeded the threshold */
+		struct Report
+		{
+			Report()
+				: category(QtSignalTrace::SignalDispatch)
+				, callback(0)
+				, detail(-1)
+				, durationUsecs(0)
+				, guiThread(false)
+			{}
+
+			QtSignalTrace::Category category;
+
+			/** The class name of the sender */
+			QByteArray senderClass;
+
+			/** The signal signature or event type */
+			QByteArray name;
+
+			/** The identity of the callback (see QtMetacallAdapter::identity()) */
+			const void* callback;
+
+			/** The signal index or event type */
+			int detail;
+
+			qint64 durationUsecs;
+
+			/** True if the callback was invoked on the main thread */
+			bool guiThread;
+		};
+
+		static void setEnabled(bool enabled);
+		static bool isEnabled()
+		{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+			return s_enabled.loadAcquire() != 0;
+#else
+			return s_enabled != 0;
+#endif
+		}
+
+		/** Sets the duration in microseconds above which callbacks on the main thread
+		 * are reported.  Defaults to 8000.
+		 */
+		static void setGuiThreadThreshold(int usecs);
+		static int guiThreadThreshold();
+
+		/** Sets the duration in microseconds above which callbacks on threads other than
+		 * the main thread are reported.  Defaults to 50000.
+		 */
+		static void setThreshold(int usecs);
+		static int threshold();
+
+		/** Sets the watchdog to time one in every @p interval dispatches.
+		 * Defaults to 32.  An interval of 1 times every dispatch, which
+		 * adds two clock reads to each dispatch.
+		 */
+		static void setSampleInterval(int interval);
+		static int sampleInterval();
+
+		/** Sets the maximum number of reports which are kept.  Once the limit
+		 * is reached, the oldest reports are discarded.  Defaults to 100.
+		 */
+		static void setMaxReports(int count);
+		static int maxReports();
+
+		/** Returns the reports for slow callbacks, oldest first. */
+		static QList<Report> reports();
+
+		/** Returns the reports for slow callbacks and clears the list. */
+		static QList<Report> takeReports();
+
+		/** Returns the number of reports discarded because the list was full. */
+		static quint64 droppedReportCount();
+
+		/** Clears the reports and dropped report count. */
+		static void clear();
+
+		/** Times a dispatch from construction until destruction if the
+		 * watchdog is enabled and the dispatch is sampled.
+		 */
+		class Scope
+		{
+			public:
+				Scope(QtSignalTrace::Category category, const QObject* object, int detail,
+					const void* callback)
+					: m_startTime(-1)
+				{
+					if (isEnabled()) {
+						begin(category, object, detail, callback);
+					}
+				}
+
+				~Scope()
+				{
+					if (m_startTime >= 0) {
+						end();
+					}
+				}
+
+			private:
+				Q_DISABLE_COPY(Scope)
+
+				void begin(QtSignalTrace::Category category, const QObject* object, int detail,
+					const void* callback);
+				void end();
+
+				qint64 m_startTime;
+				QtSignalTrace::Category m_category;
+				const QMetaObject* m_metaObject;
+				int m_detail;
+				const void* m_callback;
+		};
+
+	private:
+		static QAtomicInt s_enabled;
+};
+
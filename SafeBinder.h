@@ -2,10 +2,17 @@
 
 #include "FunctionUtils.h"
 #include "FunctionTraits.h"
+#include "QtCallbackScope.h"
 
 #include <QtCore/QDebug>
 #include <QtCore/QPointer>
+#include <QtCore/QSharedData>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
+
+#if defined(QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES) && defined(QST_COMPILER_SUPPORTS_RVALUE_REFERENCES)
+#include <utility>
+#endif
 
 namespace QtSignalTools
 {
@@ -52,14 +59,17 @@ struct StrongRef<QPointer<T> >
 	{
 		// There is no way to actually promote QPointer<T> to
 		// a strong reference, so we can't do that here as
-		// we do for other StrongRef implementations
+		// we do for other StrongRef implementations.
+		//
+		// The QPointer is referenced rather than copied to
+		// avoid updating its reference count on each call
 	}
 
 	T* data() const {
 		return m_ref.data();
 	}
 
-	QPointer<T> m_ref;
+	const QPointer<T>& m_ref;
 };
 
 // version for weak_ptr<T>
@@ -77,6 +87,35 @@ struct StrongRef<WeakPointer<T> >
 	shared_ptr<T> m_strongRef;
 };
 
+// ScopedRef is a reference to an object which is treated as
+// destroyed once a QtCallbackScope is invalidated
+template <class T>
+struct ScopedRef
+{
+	ScopedRef(const QtCallbackScope& scope, T* object)
+		: token(scope.token())
+		, ptr(object)
+	{}
+
+	QtCallbackScope::Token token;
+	T* ptr;
+};
+
+// version for ScopedRef<T>
+template <class T>
+struct StrongRef<ScopedRef<T> >
+{
+	StrongRef(ScopedRef<T>& ref)
+		: m_ref(ref)
+	{}
+
+	T* data() const {
+		return m_ref.token.isExpired() ? 0 : m_ref.ptr;
+	}
+
+	const ScopedRef<T>& m_ref;
+};
+
 template <class Receiver, class MemberFunc>
 class SafeBinder
 {
@@ -99,8 +138,22 @@ class SafeBinder
 			}\
 		}
 
-#ifdef QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
-		SAFE_BINDER_CALL_OP(template <typename... Args>, Args... args, args...)
+#if defined(QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES) && defined(QST_COMPILER_SUPPORTS_RVALUE_REFERENCES)
+		// arguments are forwarded to the wrapped method without copying, so
+		// move-only arguments and large implicitly shared values are passed
+		// through unchanged
+		template <typename... Args>
+		result_type operator()(Args&&... args)
+		  QST_NOEXCEPT_IF(noexcept((std::declval<decltype(std::declval<StrongRef<Receiver>&>().data())>()
+		    ->*std::declval<MemberFunc&>())(std::declval<Args>()...)) && noexcept(result_type()))
+		{
+			StrongRef<Receiver> strongRef(m_receiver);
+			if (strongRef.data()) {
+				return (strongRef.data()->*m_func)(std::forward<Args>(args)...);
+			} else {
+				return result_type();
+			}
+		}
 #else
 		SAFE_BINDER_CALL_OP(,,)
 		SAFE_BINDER_CALL_OP(template <class T1>, const T1& arg1, arg1)
@@ -153,7 +206,11 @@ SafeBinder<WeakPointer<T>,MemberFunc> safe_bind(const WeakPointer<T>& r, MemberF
 
 // Under Qt 4 QWeakPointer is the most efficient weak reference
 // to QObject.  Under Qt 5, QWeakPointer no longer integrates with
-// QObject but QPointer was instead re-written to be more efficient
+// QObject.  QPointer was instead re-written to be more efficient.  It is
+// tracked by the object itself rather than by a connection, so it cannot be
+// defeated by disconnecting the object's signals.  Copying it updates a shared
+// reference count, but the wrapper only copies it when the wrapper itself is
+// copied - calls check it in place with a single load.
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
 template <class T, class MemberFunc>
 SafeBinder<QPointer<T>,MemberFunc> safe_bind(T* r, MemberFunc f,
@@ -170,5 +227,197 @@ SafeBinder<QWeakPointer<T>,MemberFunc> safe_bind(T* r, MemberFunc f,
 }
 #endif
 
+/** Version of safe_bind() which uses a QtCallbackScope instead of tracking
+ * the lifetime of the object.  The method is called on @p r until @p scope
+ * is invalidated or destroyed.  This does not require any per-wrapper guard,
+ * but the scope must be invalidated before @p r is destroyed.
+ *
+ * Usage:
+ *
+ *   function<void(QByteArray)> callback(safe_bind(m_requestScope, this, &ItemView::pageFetched));
+ *   ...
+ *   m_requestScope.invalidate(); // 'callback' now does nothing
+ */
+template <class T, class MemberFunc>
+SafeBinder<ScopedRef<T>,MemberFunc> safe_bind(const QtCallbackScope& scope, T* r, MemberFunc f)
+{
+	return SafeBinder<ScopedRef<T>,MemberFunc>(ScopedRef<T>(scope,r),f);
+}
+
+// SafeBindReceiver maps the type of an object passed to safe_bind_all()
+// to the weak reference type used to detect when it is destroyed
+template <class T>
+struct SafeBindReceiver
+{
+	// T is expected to be a weak pointer type
+	typedef T type;
+};
+
+template <class T>
+struct SafeBindReceiver<T*>
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	typedef QPointer<T> type;
+#else
+	typedef QWeakPointer<T> type;
+#endif
+};
+
+template <class Receiver, class MemberFunc>
+class SafeMulticastBinder
+{
+	public:
+		typedef void result_type;
+
+		template <class Container>
+		SafeMulticastBinder(const Container& receivers, MemberFunc func)
+		: d(new Data)
+		, m_func(func)
+		{
+			d->receivers.reserve(receivers.size());
+			for (typename Container::const_iterator iter = receivers.begin();
+			     iter != receivers.end(); ++iter) {
+				d->receivers.append(Receiver(*iter));
+			}
+		}
+
+		/** Returns the number of receivers which have not yet
+		 * been found to be destroyed.
+		 */
+		int receiverCount() const
+		{
+			return d->receivers.count();
+		}
+
+// invokes the method on each live receiver and then removes
+// any destroyed receivers which were found, unless this is a
+// nested call
+#define SAFE_MULTICAST_CALL_OP(typesExpr, paramExpr, argsExpr) \
+		typesExpr\
+		void operator()(paramExpr) {\
+			int deadCount = 0;\
+			{\
+				CallDepthGuard depthGuard(d.data());\
+				Receiver* receivers = d->receivers.data();\
+				int count = d->receivers.count();\
+				for (int i=0; i < count; i++) {\
+					StrongRef<Receiver> strongRef(receivers[i]);\
+					if (strongRef.data()) {\
+						(strongRef.data()->*m_func)(argsExpr);\
+					} else {\
+						++deadCount;\
+					}\
+				}\
+			}\
+			if (deadCount > 0 && d->callDepth == 0) {\
+				pruneReceivers();\
+			}\
+		}
+
+#if defined(QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES) && defined(QST_COMPILER_SUPPORTS_RVALUE_REFERENCES)
+		// arguments are passed to each receiver as lvalues, since
+		// they cannot be moved into more than one call
+		SAFE_MULTICAST_CALL_OP(template <typename... Args>, Args&&... args, args...)
+#else
+		SAFE_MULTICAST_CALL_OP(,,)
+		SAFE_MULTICAST_CALL_OP(template <class T1>, const T1& arg1, arg1)
+		SAFE_MULTICAST_CALL_OP(template <class T1 QST_COMMA class T2>,
+							const T1& arg1 QST_COMMA const T2& arg2,
+							arg1 QST_COMMA arg2);
+		SAFE_MULTICAST_CALL_OP(template <class T1 QST_COMMA class T2 QST_COMMA class T3>,
+							const T1& arg1 QST_COMMA const T2& arg2 QST_COMMA const T3& arg3,
+							arg1 QST_COMMA arg2 QST_COMMA arg3);
+#endif
+
+	private:
+		// the receiver list is shared between copies of the binder
+		// (eg. copies made by function<>), so receivers pruned by one copy
+		// are not checked again by the others
+		struct Data : public QSharedData
+		{
+			Data()
+				: callDepth(0)
+			{}
+
+			QVector<Receiver> receivers;
+
+			// number of calls in progress.  The receivers are only
+			// pruned when this is zero, as pruning moves them.
+			int callDepth;
+		};
+
+		// tracks a call in progress, including when
+		// a receiver throws an exception
+		struct CallDepthGuard
+		{
+			CallDepthGuard(Data* _d)
+				: d(_d)
+			{
+				++d->callDepth;
+			}
+
+			~CallDepthGuard()
+			{
+				--d->callDepth;
+			}
+
+			Data* d;
+		};
+
+		void pruneReceivers()
+		{
+			Receiver* receivers = d->receivers.data();
+			int count = d->receivers.count();
+			int liveCount = 0;
+			for (int i=0; i < count; i++) {
+				StrongRef<Receiver> strongRef(receivers[i]);
+				if (strongRef.data()) {
+					if (liveCount != i) {
+						receivers[liveCount] = receivers[i];
+					}
+					++liveCount;
+				}
+			}
+			d->receivers.resize(liveCount);
+		}
+
+		QExplicitlySharedDataPointer<Data> d;
+		MemberFunc m_func;
+};
+
+/** safe_bind_all() creates a wrapper around a method call which invokes
+ * the method on each object in a list which has not been destroyed.
+ * Destroyed objects are removed from the wrapper's list when they are
+ * next encountered.
+ *
+ * The syntax is:
+ *   safe_bind_all(objects, method)
+ *
+ * Where 'objects' is a container (eg. QList, QVector or std::vector) of either
+ * QObject pointers or weak_ptr<T> / QWeakPointer<T> references.
+ *
+ * This is cheaper than keeping a list of individual safe_bind() wrappers, as
+ * there is a single function object for all of the receivers and the receivers
+ * are kept in a compact array.  QObject receivers are tracked with QPointer
+ * (QWeakPointer with Qt 4), so creating a wrapper does not add connections
+ * to the receivers.
+ *
+ * Copies of the wrapper share the receiver list, which is not synchronized.
+ * The wrapper and its copies must only be called from one thread at a time,
+ * normally the thread that the receivers live in.
+ *
+ * Usage:
+ *
+ *   QList<QLabel*> labels;
+ *   function<void(QString)> setAllText(safe_bind_all(labels, &QLabel::setText));
+ *   setAllText("Hello"); // sets the text on each label which still exists
+ */
+template <class Container, class MemberFunc>
+SafeMulticastBinder<typename SafeBindReceiver<typename Container::value_type>::type,MemberFunc>
+  safe_bind_all(const Container& receivers, MemberFunc f)
+{
+	typedef typename SafeBindReceiver<typename Container::value_type>::type Receiver;
+	return SafeMulticastBinder<Receiver,MemberFunc>(receivers,f);
 }
 
+}
@@ -1,6 +1,5 @@
-QT += network
 INCLUDEPATH += ../..
-HEADERS += ../../QtCallback.h ../../QtSignalForwarder.h
-SOURCES += ../../QtCallback.cpp ../../QtSignalForwarder.cpp
+HEADERS += ../../QtArgumentCodec.h ../../QtBoundedQueue.h ../../QtCallback.h ../../QtCallbackScope.h ../../QtSignalAwaiter.h ../../QtSignalBatcher.h ../../QtSignalRecorder.h ../../QtSignalToolsPrivate.h ../../QtSignalTrace.h ../../QtSignalWatchdog.h ../../QtSignalForwarder.h
+SOURCES += ../../QtArgumentCodec.cpp ../../QtBoundedQueue.cpp ../../QtCallback.cpp ../../QtSignalBatcher.cpp ../../QtSignalForwarder.cpp ../../QtSignalRecorder.cpp ../../QtSignalTrace.cpp ../../QtSignalWatchdog.cpp
 
 CONFIG -= app_bundle
@@ -0,0 +1,5 @@
+# QtRemoteSignalSender and QtRemoteSignalReceiver, which require QtNetwork.
+# Include this after common.pri in projects which use them.
+QT += network
+HEADERS += ../../QtRemoteSignal.h
+SOURCES += ../../QtRemoteSignal.cpp
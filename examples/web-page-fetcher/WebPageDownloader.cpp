@@ -25,7 +25,8 @@ void PageFetcher::fetchPage(const QUrl& url, const QtCallback1<QByteArray>& call
 	finishedCallback.bind(reply);
 	finishedCallback.bind(callback);
 
-	QtSignalForwarder::connect(reply, SIGNAL(finished()), finishedCallback);
+	// the reply only finishes once, so the binding can be removed as soon as it fires
+	QtSignalForwarder::connect(reply, SIGNAL(finished()), finishedCallback, QtSignalForwarder::SingleShot);
 }
 
 void PageFetcher::requestFinished(QNetworkReply* reply, const QtCallback1<QByteArray>& callback)
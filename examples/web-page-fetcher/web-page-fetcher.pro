@@ -1,7 +1,7 @@
 include(../common.pri)
 
 TEMPLATE = app
-QT += concurrent
+QT += concurrent network
 
 HEADERS += WebPageDownloader.h
 SOURCES += WebPageDownloader.cpp
@@ -0,0 +1,221 @@
+#include "AllocationCounter.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+
+// glibc's implementations, which the interposed
+// functions below forward to
+extern "C"
+{
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+
+#define QST_INTERPOSE_MALLOC
+#endif
+
+namespace
+{
+
+volatile bool s_counting = false;
+qint64 s_allocationCount = 0;
+qint64 s_netBytes = 0;
+
+void addToCounter(qint64* counter, qint64 value)
+{
+#if defined(__GNUC__)
+	__sync_fetch_and_add(counter, value);
+#else
+	*counter += value;
+#endif
+}
+
+void recordAlloc(size_t size)
+{
+	if (s_counting) {
+		addToCounter(&s_allocationCount, 1);
+		addToCounter(&s_netBytes, static_cast<qint64>(size));
+	}
+}
+
+void recordFree(size_t size)
+{
+	if (s_counting) {
+		addToCounter(&s_netBytes, -static_cast<qint64>(size));
+	}
+}
+
+}
+
+#ifdef QST_INTERPOSE_MALLOC
+
+// sizes are measured with malloc_usable_size() so that the
+// values recorded for an allocation and the matching free() agree
+
+extern "C" void* malloc(size_t size)
+{
+	void* ptr = __libc_malloc(size);
+	if (ptr) {
+		recordAlloc(malloc_usable_size(ptr));
+	}
+	return ptr;
+}
+
+extern "C" void* calloc(size_t count, size_t size)
+{
+	void* ptr = __libc_calloc(count, size);
+	if (ptr) {
+		recordAlloc(malloc_usable_size(ptr));
+	}
+	return ptr;
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+	size_t oldSize = ptr ? malloc_usable_size(ptr) : 0;
+	void* newPtr = __libc_realloc(ptr, size);
+	if (newPtr) {
+		recordFree(oldSize);
+		recordAlloc(malloc_usable_size(newPtr));
+	} else if (size == 0) {
+		recordFree(oldSize);
+	}
+	return newPtr;
+}
+
+extern "C" void* memalign(size_t alignment, size_t size)
+{
+	void* ptr = __libc_memalign(alignment, size);
+	if (ptr) {
+		recordAlloc(malloc_usable_size(ptr));
+	}
+	return ptr;
+}
+
+extern "C" int posix_memalign(void** result, size_t alignment, size_t size)
+{
+	void* ptr = memalign(alignment, size);
+	if (!ptr) {
+		return ENOMEM;
+	}
+	*result = ptr;
+	return 0;
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size)
+{
+	return memalign(alignment, size);
+}
+
+extern "C" void free(void* ptr)
+{
+	if (ptr) {
+		recordFree(malloc_usable_size(ptr));
+	}
+	__libc_free(ptr);
+}
+
+#else
+
+// without malloc() interposition, count allocations made with operator new.
+// Each block is prefixed with its size so that it can be recorded when freed.
+
+#if __cplusplus >= 201103L
+#define QST_NEW_THROW_SPEC
+#define QST_DELETE_THROW_SPEC noexcept
+#else
+#define QST_NEW_THROW_SPEC throw(std::bad_alloc)
+#define QST_DELETE_THROW_SPEC throw()
+#endif
+
+namespace
+{
+
+// size of the header before each block, chosen to preserve
+// the alignment of the returned pointer
+const size_t HEADER_SIZE = 16;
+
+void* countedAlloc(size_t size)
+{
+	char* block = static_cast<char*>(std::malloc(size + HEADER_SIZE));
+	if (!block) {
+		throw std::bad_alloc();
+	}
+	*reinterpret_cast<size_t*>(block) = size;
+	recordAlloc(size);
+	return block + HEADER_SIZE;
+}
+
+void countedFree(void* ptr)
+{
+	if (!ptr) {
+		return;
+	}
+	char* block = static_cast<char*>(ptr) - HEADER_SIZE;
+	recordFree(*reinterpret_cast<size_t*>(block));
+	std::free(block);
+}
+
+}
+
+void* operator new(size_t size) QST_NEW_THROW_SPEC
+{
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size) QST_NEW_THROW_SPEC
+{
+	return countedAlloc(size);
+}
+
+void operator delete(void* ptr) QST_DELETE_THROW_SPEC
+{
+	countedFree(ptr);
+}
+
+void operator delete[](void* ptr) QST_DELETE_THROW_SPEC
+{
+	countedFree(ptr);
+}
+
+#endif // QST_INTERPOSE_MALLOC
+
+void AllocationCounter::start()
+{
+	s_counting = false;
+	s_allocationCount = 0;
+	s_netBytes = 0;
+	s_counting = true;
+}
+
+void AllocationCounter::stop()
+{
+	s_counting = false;
+}
+
+qint64 AllocationCounter::allocationCount()
+{
+	return s_allocationCount;
+}
+
+qint64 AllocationCounter::netBytes()
+{
+	return s_netBytes;
+}
+
+bool AllocationCounter::countsMalloc()
+{
+#ifdef QST_INTERPOSE_MALLOC
+	return true;
+#else
+	return false;
+#endif
+}
+
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QtCore/QtGlobal>
+
+/** Counts the heap allocations made by the test process between
+ * start() and stop().
+ *
+ * On Linux with glibc, malloc() and related functions are interposed, so allocations
+ * made by Qt's containers are counted as well as those made with operator new.
+ * On other platforms, only allocations made with operator new are counted.
+ *
+ * Allocations from all threads are counted.
+ */
+class AllocationCounter
+{
+	public:
+		/** Resets the counters and starts counting */
+		static void start();
+		static void stop();
+
+		/** Returns the number of allocations made while counting */
+		static qint64 allocationCount();
+
+		/** Returns the number of bytes allocated minus the number of bytes
+		 * freed while counting.
+		 */
+		static qint64 netBytes();
+
+		/** Returns true if allocations made with malloc(), which Qt's
+		 * containers use, are counted.
+		 */
+		static bool countsMalloc();
+};
+
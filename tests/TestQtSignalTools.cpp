@@ -1,9 +1,20 @@
 #include "TestQtSignalTools.h"
 
+#include "AllocationCounter.h"
+#include "QtArgumentCodec.h"
+#include "QtBoundedQueue.h"
+#include "QtRemoteSignal.h"
+#include "QtSignalBatcher.h"
+#include "QtSignalAwaiter.h"
+#include "QtSignalRecorder.h"
+#include "QtSignalTrace.h"
+#include "QtSignalWatchdog.h"
 #include "SafeBinder.h"
 
 #include <QtCore/QDebug>
+#include <QtCore/QDir>
 #include <QtCore/QEventLoop>
+#include <QtCore/QPoint>
 
 #if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
 #include <QtCore/QElapsedTimer>
@@ -11,14 +22,35 @@
 
 #include <QtCore/QThread>
 
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtWidgets/QApplication>
+#include <QtWidgets/QWidget>
+#else
+#include <QtGui/QApplication>
+#include <QtGui/QWidget>
+#endif
+
+#include <algorithm>
 #include <iostream>
 
+#ifdef QST_COMPILER_SUPPORTS_COROUTINES
+#include <thread>
+#endif
+
 #if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
 #define SKIP_TEST(message) QSKIP(message)
 #else
 #define SKIP_TEST(message) QSKIP(message, SkipAll)
 #endif
 
+// benchmarks are skipped unless the QST_BENCHMARKS environment variable is set
+#define SKIP_BENCHMARK() \
+	if (qgetenv("QST_BENCHMARKS").isEmpty()) { \
+		SKIP_TEST("Benchmark disabled.  Set QST_BENCHMARKS=1 to run"); \
+	}
+
 #if defined(QST_USE_CPP11_LIBS)
 using namespace std;
 using namespace std::placeholders;
@@ -186,6 +218,14 @@ void TestQtSignalTools::testArgTypeCheck()
 
 void fiveArgFunc(int,bool,float,char,double) {}
 
+#ifdef QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
+QString manyArgsResult;
+void manyArgsFunc(int a, bool b, float c, char d, double e, const QString& f, int g)
+{
+	manyArgsResult = QString("%1,%2,%3,%4,%5,%6,%7").arg(a).arg(int(b)).arg(c).arg(d).arg(e).arg(f).arg(g);
+}
+#endif
+
 void TestQtSignalTools::testArgLimit()
 {
 	QtMetacallAdapter adapter(fiveArgFunc);
@@ -196,6 +236,32 @@ void TestQtSignalTools::testArgLimit()
 		argList << QMetaType::typeName(args[i]);
 	}
 	QCOMPARE(argList, QStringList() << "int" << "bool" << "float" << "char" << "double");
+
+#ifdef QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
+	// receivers with more than five arguments, which may be passed
+	// by const reference
+	QtMetacallAdapter manyArgsAdapter(manyArgsFunc);
+	count = manyArgsAdapter.getArgTypes(args);
+	argList.clear();
+	for (int i=0; i < count; i++) {
+		argList << QMetaType::typeName(args[i]);
+	}
+	QCOMPARE(argList, QStringList() << "int" << "bool" << "float" << "char" << "double"
+	  << "QString" << "int");
+
+	int intArg = 3;
+	bool boolArg = true;
+	float floatArg = 1.5;
+	char charArg = 'a';
+	double doubleArg = 2.5;
+	QString stringArg = "test";
+	int lastArg = 4;
+	QGenericArgument invokeArgs[] = {Q_ARG(int, intArg), Q_ARG(bool, boolArg), Q_ARG(float, floatArg),
+	  Q_ARG(char, charArg), Q_ARG(double, doubleArg), Q_ARG(QString, stringArg), Q_ARG(int, lastArg)};
+	QVERIFY(!manyArgsAdapter.invoke(invokeArgs, 6));
+	QVERIFY(manyArgsAdapter.invoke(invokeArgs, 7));
+	QCOMPARE(manyArgsResult, QString("3,1,1.5,a,2.5,test,4"));
+#endif
 }
 
 void TestQtSignalTools::testSignalToLambda()
@@ -209,6 +275,16 @@ void TestQtSignalTools::testSignalToLambda()
 	tester.emitASignal(12);
 	tester.emitASignal(7);
 	QCOMPARE(sum, 19);
+
+#ifdef QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES
+	// lambdas can also be passed directly, without wrapping
+	// them in a function<>
+	QString lastString;
+	QtSignalForwarder::connect(&tester, SIGNAL(stringSignal(QString)),
+	  [&](const QString& value) { lastString = value; });
+	tester.emitStringSignal("Hello");
+	QCOMPARE(lastString, QString("Hello"));
+#endif
 #else
 	SKIP_TEST("Compiler does not support C++11 lambdas");
 #endif
@@ -229,6 +305,17 @@ void TestQtSignalTools::testSenderDestroyed()
 	QCOMPARE(proxy.bindingCount(), 1);
 	tester.reset();
 	QCOMPARE(proxy.bindingCount(), 0);
+
+	// bindings for destroyed() are invoked even if they were
+	// added after the sender's other bindings
+	CallCounter counter;
+	tester.reset(new CallbackTester);
+	proxy.bind(tester.data(), SIGNAL(aSignal(int)), noArgsFunc);
+	proxy.bind(tester.data(), SIGNAL(destroyed(QObject*)),
+	  function<void()>(bind(&CallCounter::increment, &counter)));
+	tester.reset();
+	QCOMPARE(counter.count, 1);
+	QCOMPARE(proxy.bindingCount(), 0);
 }
 
 void TestQtSignalTools::testUnbind()
@@ -279,12 +366,19 @@ void TestQtSignalTools::testProxyBindingLimits()
 	}
 	tester.emitNoArgSignal();
 	QCOMPARE(counter.count, bindingCount);
+
+	// the bindings are spread across several proxies,
+	// all of which should be disconnected
+	QtSignalForwarder::disconnect(&tester, SIGNAL(noArgSignal()));
+	tester.emitNoArgSignal();
+	QCOMPARE(counter.count, bindingCount);
+	QCOMPARE(tester.receiverCount(SIGNAL(noArgSignal())), 0);
 }
 
 void TestQtSignalTools::testConnectPerf()
 {
 #if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
-	SKIP_TEST("Benchmark disabled");
+	SKIP_BENCHMARK();
 
 	CallbackTester receiver;
 
@@ -341,16 +435,35 @@ void TestQtSignalTools::testDelayedCall()
 #endif
 }
 
+#if defined(QST_USE_CPP11_LIBS)
+struct MoveOnlyArgSink
+{
+	MoveOnlyArgSink()
+		: total(0)
+	{}
+
+	void take(unique_ptr<int> value)
+	{
+		total += *value;
+	}
+
+	int total;
+};
+#endif
+
 void TestQtSignalTools::testSafeBinder()
 {
 	// test with a QObject
 	QObject* object = new QObject;
 	object->setObjectName("testObject");
 	function<QString()> getName(safe_bind(object, &QObject::objectName));
+	function<QString()> getNameCopy(getName);
 	QCOMPARE(getName(), QString("testObject"));
+	QCOMPARE(getNameCopy(), QString("testObject"));
 	delete object;
 	object = 0;
 	QCOMPARE(getName(), QString());
+	QCOMPARE(getNameCopy(), QString());
 
 	CallbackTester tester;
 	object = new QObject;
@@ -366,6 +479,26 @@ void TestQtSignalTools::testSafeBinder()
 	// as the object has been destroyed
 	tester.emitStringSignal("newName");
 
+	// creating wrappers does not add connections to the object
+	CallbackTester receiver;
+	int destroyedReceivers = receiver.receiverCount(SIGNAL(destroyed(QObject*)));
+	for (int i=0; i < 10; i++) {
+		function<void(int)> addValue(safe_bind(&receiver, &CallbackTester::addValue));
+		addValue(i);
+	}
+	QCOMPARE(receiver.values.count(), 10);
+	QCOMPARE(receiver.receiverCount(SIGNAL(destroyed(QObject*))), destroyedReceivers);
+
+	// disconnecting all of the object's signals does not stop the
+	// wrapper from detecting that the object has been destroyed
+	CallbackTester* disconnected = new CallbackTester;
+	function<void(int)> addToDisconnected(safe_bind(disconnected, &CallbackTester::addValue));
+	addToDisconnected(1);
+	QCOMPARE(disconnected->values, QList<int>() << 1);
+	disconnected->disconnect();
+	delete disconnected;
+	addToDisconnected(2);
+
 	// test with something that is not
 	// a QObject
 	shared_ptr<QString> string(new QString);
@@ -374,6 +507,109 @@ void TestQtSignalTools::testSafeBinder()
 	QCOMPARE(getTrimmed(), QString("testString"));
 	string.reset();
 	QCOMPARE(getTrimmed(), QString());
+
+#if defined(QST_COMPILER_SUPPORTS_VARIADIC_TEMPLATES) && defined(QST_COMPILER_SUPPORTS_RVALUE_REFERENCES) && \
+    defined(QST_USE_CPP11_LIBS)
+	// test forwarding of move-only arguments
+	shared_ptr<MoveOnlyArgSink> sink(new MoveOnlyArgSink);
+	safe_bind(weak_ptr<MoveOnlyArgSink>(sink), &MoveOnlyArgSink::take)(unique_ptr<int>(new int(5)));
+	QCOMPARE(sink->total, 5);
+#endif
+}
+
+void TestQtSignalTools::testSafeBindAll()
+{
+	QList<QObject*> objects;
+	for (int i=0; i < 3; i++) {
+		objects << new QObject;
+	}
+
+	SafeMulticastBinder<SafeBindReceiver<QObject*>::type,void (QObject::*)(const QString&)> setNames =
+	  safe_bind_all(objects, &QObject::setObjectName);
+	function<void(QString)> setNamesFunc(setNames);
+	QCOMPARE(setNames.receiverCount(), 3);
+
+	setNamesFunc("first");
+	Q_FOREACH(QObject* object, objects) {
+		QCOMPARE(object->objectName(), QString("first"));
+	}
+
+	// destroyed receivers are skipped and then removed
+	delete objects.takeAt(1);
+	setNamesFunc("second");
+	Q_FOREACH(QObject* object, objects) {
+		QCOMPARE(object->objectName(), QString("second"));
+	}
+	QCOMPARE(setNames.receiverCount(), 2);
+
+	qDeleteAll(objects);
+	setNamesFunc("third");
+	QCOMPARE(setNames.receiverCount(), 0);
+
+	// creating wrappers repeatedly does not add
+	// connections to the receivers
+	QList<CallbackTester*> testers;
+	testers << new CallbackTester << new CallbackTester;
+	for (int i=0; i < 10; i++) {
+		function<void(int)> addValues(safe_bind_all(testers, &CallbackTester::addValue));
+		addValues(i);
+	}
+	Q_FOREACH(CallbackTester* tester, testers) {
+		QCOMPARE(tester->values.count(), 10);
+		QCOMPARE(tester->receiverCount(SIGNAL(destroyed(QObject*))), 0);
+	}
+	qDeleteAll(testers);
+
+	// test with objects which are not QObjects
+	QList<shared_ptr<CallCounter> > counters;
+	QList<weak_ptr<CallCounter> > weakCounters;
+	for (int i=0; i < 2; i++) {
+		counters << shared_ptr<CallCounter>(new CallCounter);
+		weakCounters << counters.last();
+	}
+	function<void()> incrementAll(safe_bind_all(weakCounters, &CallCounter::increment));
+	incrementAll();
+	counters.removeFirst();
+	incrementAll();
+	QCOMPARE(counters.first()->count, 2);
+}
+
+void TestQtSignalTools::testCallbackScope()
+{
+	CallbackTester tester;
+	CallCounter counter;
+	QScopedPointer<QtCallbackScope> scope(new QtCallbackScope);
+
+	QtCallback1<int> callback(&tester, SLOT(addValue(int)));
+	callback.setScope(*scope);
+	QVERIFY(callback.invoke(1));
+
+	QtSignalForwarder::connect(&tester, SIGNAL(noArgSignal()),
+	  QtMetacallAdapter(function<void()>(bind(&CallCounter::increment, &counter))).setScope(*scope));
+	tester.emitNoArgSignal();
+	QCOMPARE(counter.count, 1);
+
+	function<void(int)> addValue(safe_bind(*scope, &tester, &CallbackTester::addValue));
+	addValue(2);
+	QCOMPARE(tester.values, QList<int>() << 1 << 2);
+
+	// invalidating the scope turns all attached callbacks into no-ops
+	QtCallbackScope::Token token = scope->token();
+	scope->invalidate();
+	QVERIFY(token.isExpired());
+	QVERIFY(!callback.invoke(3));
+	tester.emitNoArgSignal();
+	QCOMPARE(counter.count, 1);
+	addValue(4);
+	QCOMPARE(tester.values, QList<int>() << 1 << 2);
+
+	// callbacks attached after invalidation are live until the
+	// scope is invalidated again or destroyed
+	callback.setScope(*scope);
+	QVERIFY(callback.invoke(5));
+	scope.reset();
+	QVERIFY(!callback.invoke(6));
+	QCOMPARE(tester.values, QList<int>() << 1 << 2 << 5);
 }
 
 function<void()> incrementFunc(CallCounter& counter)
@@ -419,6 +655,47 @@ void TestQtSignalTools::testBindingCount()
 	QCOMPARE(forwarder.bindingCount(), 0);
 }
 
+void TestQtSignalTools::testBindingStatistics()
+{
+	CallbackTester tester;
+	CallbackTester otherTester;
+
+	QtSignalForwarder forwarder;
+	forwarder.bind(&tester, SIGNAL(aSignal(int)), noArgsFunc);
+	forwarder.bind(&tester, SIGNAL(aSignal(int)), intFunc);
+	forwarder.bind(&otherTester, SIGNAL(noArgSignal()), noArgsFunc);
+	forwarder.bind(&tester, QEvent::Enter, noArgsFunc);
+
+	QtSignalForwarder::Statistics stats = forwarder.statistics();
+	QCOMPARE(stats.proxyCount, 1);
+	QCOMPARE(stats.signalBindingCount, 3);
+	QCOMPARE(stats.eventBindingCount, 1);
+	QCOMPARE(stats.senderCount, 2);
+	QCOMPARE(stats.eventFilterCount, 1);
+	QCOMPARE(stats.bindingsBySenderClass.value("CallbackTester"), 4);
+	QCOMPARE(stats.bindingsBySignal.value("CallbackTester::aSignal(int)"), 2);
+	QCOMPARE(stats.bindingsBySignal.value("CallbackTester::noArgSignal()"), 1);
+	QCOMPARE(stats.bindingsByEventType.value(QEvent::Enter), 1);
+	QVERIFY(stats.estimatedBytes > 0);
+
+	// removing bindings updates the counts and releases the event filter
+	forwarder.unbind(&tester, QEvent::Enter);
+	forwarder.unbind(&otherTester);
+	stats = forwarder.statistics();
+	QCOMPARE(stats.signalBindingCount, 2);
+	QCOMPARE(stats.eventBindingCount, 0);
+	QCOMPARE(stats.senderCount, 1);
+	QCOMPARE(stats.eventFilterCount, 0);
+	QCOMPARE(forwarder.bindingCount(), 2);
+
+	// shared proxies used by connect() in this thread
+	int sharedBindings = QtSignalForwarder::sharedProxyStatistics().signalBindingCount;
+	QtSignalForwarder::connect(&otherTester, SIGNAL(aSignal(int)), intFunc);
+	QtSignalForwarder::Statistics sharedStats = QtSignalForwarder::sharedProxyStatistics();
+	QCOMPARE(sharedStats.signalBindingCount, sharedBindings + 1);
+	QVERIFY(sharedStats.proxyCount >= 1);
+}
+
 void TestQtSignalTools::testManySenders()
 {
 	typedef QSet<CallbackTester*>::const_iterator SetIter;
@@ -447,6 +724,379 @@ void TestQtSignalTools::testConnectWithSender()
 	QCOMPARE(sender.values, QList<int>() << 34);
 }
 
+void recordSender(QObject** senderOut, int* valueOut, QObject* sender, int value)
+{
+	*senderOut = sender;
+	*valueOut = value;
+}
+
+void TestQtSignalTools::testPassSender()
+{
+	CallbackTester sender;
+
+	// sender passed to a function object
+	QObject* receivedSender = 0;
+	int receivedValue = 0;
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  function<void(QObject*,int)>(bind(recordSender, &receivedSender, &receivedValue, _1, _2)),
+	  QtSignalForwarder::PassSender));
+	sender.emitASignal(12);
+	QCOMPARE(receivedSender, static_cast<QObject*>(&sender));
+	QCOMPARE(receivedValue, 12);
+	QtSignalForwarder::disconnect(&sender, SIGNAL(aSignal(int)));
+
+	// sender passed to a slot
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  QtCallback(&sender, SLOT(addValueIfSenderIsSelf(CallbackTester*,int))),
+	  QtSignalForwarder::PassSender));
+	sender.emitASignal(7);
+	QCOMPARE(sender.values, QList<int>() << 7);
+	QtSignalForwarder::disconnect(&sender, SIGNAL(aSignal(int)));
+
+	// the receiver's first argument must be able to accept the sender
+	QVERIFY(!QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)), twoArgsFunc,
+	  QtSignalForwarder::PassSender));
+
+	// the sender must be an instance of the class which the
+	// receiver's first argument points to
+	QtCallback addSeven(&sender, SLOT(addValueIfSenderIsSelf(CallbackTester*,int)));
+	addSeven.bind(1, 7);
+	QObject otherSender;
+	QVERIFY(!QtSignalForwarder::connect(&otherSender, SIGNAL(destroyed()), addSeven,
+	  QtSignalForwarder::PassSender));
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(noArgSignal()), addSeven,
+	  QtSignalForwarder::PassSender));
+	QtSignalForwarder::disconnect(&sender, SIGNAL(noArgSignal()));
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	QVERIFY(!QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)), function<void(QThread*,int)>(),
+	  QtSignalForwarder::PassSender));
+#endif
+	QCOMPARE(sender.receiverCount(SIGNAL(aSignal(int))), 0);
+}
+
+bool isOdd(int value)
+{
+	return value % 2 != 0;
+}
+
+int textLength(const QString& text)
+{
+	return text.length();
+}
+
+void recordText(QStringList* list, const QString& text)
+{
+	list->append(text);
+}
+
+// records a remote value.  For the first value, sends the sender's
+// remaining emissions, disconnects it and runs a nested event loop
+// in which the receiver is notified of the new data.
+void recordValueInEventLoop(QList<int>* values, QtRemoteSignalSender* sender, int value)
+{
+	values->append(value);
+	if (values->count() == 1) {
+		sender->disconnectFromServer();
+		QTest::qWait(100);
+	}
+}
+
+void TestQtSignalTools::testBindingStages()
+{
+	CallbackTester sender;
+	CallbackTester receiver;
+
+	// select and re-order arguments
+	QStringList texts;
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(pairSignal(int,QString)),
+	  function<void(const QString&)>(bind(recordText, &texts, _1)),
+	  QtSignalForwarder::BindingOptions().select(QList<int>() << 1)));
+	sender.emitPairSignal(1, "one");
+	QCOMPARE(texts, QStringList() << "one");
+	QtSignalForwarder::disconnect(&sender, SIGNAL(pairSignal(int,QString)));
+
+	// filter emissions
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  QtCallback(&receiver, SLOT(addValue(int))),
+	  QtSignalForwarder::BindingOptions().filter(isOdd)));
+	for (int i=0; i < 6; i++) {
+		sender.emitASignal(i);
+	}
+	QCOMPARE(receiver.values, QList<int>() << 1 << 3 << 5);
+	QtSignalForwarder::disconnect(&sender, SIGNAL(aSignal(int)));
+	receiver.values.clear();
+
+	// select, filter and map combined, with the map
+	// converting the argument to a different type
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(pairSignal(int,QString)),
+	  QtCallback(&receiver, SLOT(addValue(int))),
+	  QtSignalForwarder::BindingOptions()
+	    .select(QList<int>() << 1)
+	    .filter(function<bool(const QString&)>(bind(&QString::isEmpty, _1)))
+	    .map(textLength)));
+	sender.emitPairSignal(1, "skipped");
+	sender.emitPairSignal(2, QString());
+	QCOMPARE(receiver.values, QList<int>() << 0);
+	QtSignalForwarder::disconnect(&sender, SIGNAL(pairSignal(int,QString)));
+	receiver.values.clear();
+
+	// stages combined with PassSender
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(pairSignal(int,QString)),
+	  QtCallback(&sender, SLOT(addValueIfSenderIsSelf(CallbackTester*,int))),
+	  QtSignalForwarder::BindingOptions(QtSignalForwarder::PassSender).map(textLength)));
+	sender.emitPairSignal(3, "four");
+	QCOMPARE(sender.values, QList<int>() << 4);
+	QtSignalForwarder::disconnect(&sender, SIGNAL(pairSignal(int,QString)));
+
+	// stages which do not match the signal are rejected
+	QVERIFY(!QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)), intFunc,
+	  QtSignalForwarder::BindingOptions().select(QList<int>() << 1)));
+	QVERIFY(!QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)), intFunc,
+	  QtSignalForwarder::BindingOptions().filter(textLength)));
+	QVERIFY(!QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)), intFunc,
+	  QtSignalForwarder::BindingOptions().map(textLength)));
+	QVERIFY(!QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)), intFunc,
+	  QtSignalForwarder::BindingOptions().map(intFunc)));
+	QCOMPARE(sender.receiverCount(SIGNAL(aSignal(int))), 0);
+}
+
+void recordPair(QStringList* list, int number, const QString& text)
+{
+	list->append(QString("%1:%2").arg(number).arg(text));
+}
+
+void TestQtSignalTools::testSignalJoins()
+{
+	CallbackTester numbers;
+	CallbackTester strings;
+	QStringList pairs;
+	function<void(int,const QString&)> callback(bind(recordPair, &pairs, _1, _2));
+
+	// combine latest values, once both signals have been emitted
+	QObject* context = new QObject;
+	QVERIFY(QtSignalForwarder::combineLatest(QList<QtSignalForwarder::SignalSource>()
+	    << QtSignalForwarder::SignalSource(&numbers, SIGNAL(aSignal(int)))
+	    << QtSignalForwarder::SignalSource(&strings, SIGNAL(stringSignal(QString))),
+	  context, callback));
+	numbers.emitASignal(1);
+	QCOMPARE(pairs, QStringList());
+	strings.emitStringSignal("a");
+	numbers.emitASignal(2);
+	strings.emitStringSignal("b");
+	QCOMPARE(pairs, QStringList() << "1:a" << "2:a" << "2:b");
+
+	// destroying the context removes the join
+	delete context;
+	QCoreApplication::sendPostedEvents(0, QEvent::DeferredDelete);
+	QCOMPARE(numbers.receiverCount(SIGNAL(aSignal(int))), 0);
+	QCOMPARE(strings.receiverCount(SIGNAL(stringSignal(QString))), 0);
+	pairs.clear();
+
+	// zip emissions in order
+	context = new QObject;
+	QVERIFY(QtSignalForwarder::zip(QList<QtSignalForwarder::SignalSource>()
+	    << QtSignalForwarder::SignalSource(&numbers, SIGNAL(aSignal(int)))
+	    << QtSignalForwarder::SignalSource(&strings, SIGNAL(stringSignal(QString))),
+	  context, callback));
+	numbers.emitASignal(1);
+	numbers.emitASignal(2);
+	strings.emitStringSignal("a");
+	strings.emitStringSignal("b");
+	strings.emitStringSignal("c");
+	QCOMPARE(pairs, QStringList() << "1:a" << "2:b");
+	numbers.emitASignal(3);
+	QCOMPARE(pairs, QStringList() << "1:a" << "2:b" << "3:c");
+	delete context;
+	QCoreApplication::sendPostedEvents(0, QEvent::DeferredDelete);
+	pairs.clear();
+
+	// coalesce updates until the event loop runs
+	context = new QObject;
+	QVERIFY(QtSignalForwarder::combineLatest(QList<QtSignalForwarder::SignalSource>()
+	    << QtSignalForwarder::SignalSource(&numbers, SIGNAL(aSignal(int)))
+	    << QtSignalForwarder::SignalSource(&strings, SIGNAL(stringSignal(QString))),
+	  context, callback, QtSignalForwarder::CoalesceEmissions));
+	numbers.emitASignal(1);
+	strings.emitStringSignal("a");
+	numbers.emitASignal(2);
+	numbers.emitASignal(3);
+	QCOMPARE(pairs, QStringList());
+	QCoreApplication::processEvents();
+	QCOMPARE(pairs, QStringList() << "3:a");
+	delete context;
+	QCoreApplication::sendPostedEvents(0, QEvent::DeferredDelete);
+	pairs.clear();
+
+	// destroying one of the senders removes the join, and the
+	// remaining senders no longer invoke the callback
+	CallbackTester* numberSender = new CallbackTester;
+	QVERIFY(QtSignalForwarder::combineLatest(
+	  QtSignalForwarder::SignalSource(numberSender, SIGNAL(aSignal(int))),
+	  QtSignalForwarder::SignalSource(&strings, SIGNAL(stringSignal(QString))),
+	  callback));
+	numberSender->emitASignal(4);
+	strings.emitStringSignal("d");
+	delete numberSender;
+	strings.emitStringSignal("e");
+	QCOMPARE(pairs, QStringList() << "4:d");
+	QCoreApplication::sendPostedEvents(0, QEvent::DeferredDelete);
+	QCOMPARE(strings.receiverCount(SIGNAL(stringSignal(QString))), 0);
+
+	// the callback must accept the combined arguments
+	QVERIFY(!QtSignalForwarder::combineLatest(
+	  QtSignalForwarder::SignalSource(&strings, SIGNAL(stringSignal(QString))),
+	  QtSignalForwarder::SignalSource(&numbers, SIGNAL(aSignal(int))),
+	  callback));
+	QCOMPARE(numbers.receiverCount(SIGNAL(aSignal(int))), 0);
+}
+
+void recordAndEmit(CallbackTester* sender, QList<int>* values, int value)
+{
+	values->append(value);
+	sender->emitASignal(value + 1);
+}
+
+void TestQtSignalTools::testSingleShot()
+{
+	CallbackTester sender;
+	CallbackTester receiver;
+	int initialBindingCount = QtSignalForwarder::sharedProxyStatistics().signalBindingCount;
+
+	// binding is removed after the first emission
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  QtCallback(&receiver, SLOT(addValue(int))), QtSignalForwarder::SingleShot));
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  QtCallback(&receiver, SLOT(addValue(int))).bind(-1)));
+	sender.emitASignal(1);
+	sender.emitASignal(2);
+	QCOMPARE(receiver.values.count(-1), 2);
+	QCOMPARE(receiver.values.count(1), 1);
+	QCOMPARE(receiver.values.count(2), 0);
+	QCOMPARE(sender.receiverCount(SIGNAL(aSignal(int))), 1);
+	QtSignalForwarder::disconnect(&sender, SIGNAL(aSignal(int)));
+	QCOMPARE(QtSignalForwarder::sharedProxyStatistics().signalBindingCount, initialBindingCount);
+
+	// re-entrant emission from the callback does not invoke it again
+	QList<int> values;
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  function<void(int)>(bind(recordAndEmit, &sender, &values, _1)),
+	  QtSignalForwarder::SingleShot));
+	sender.emitASignal(1);
+	QCOMPARE(values, QList<int>() << 1);
+	QCOMPARE(sender.receiverCount(SIGNAL(aSignal(int))), 0);
+
+	// the binding is removed on the first emission, even if a filter drops it
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  QtCallback(&receiver, SLOT(addValue(int))),
+	  QtSignalForwarder::BindingOptions(QtSignalForwarder::SingleShot).filter(isOdd)));
+	sender.emitASignal(4);
+	sender.emitASignal(5);
+	QCOMPARE(receiver.values.count(5), 0);
+	QCOMPARE(QtSignalForwarder::sharedProxyStatistics().signalBindingCount, initialBindingCount);
+}
+
+void recordTag(QList<int>* tags, int tag)
+{
+	tags->append(tag);
+}
+
+bool recordTagAndStop(QList<int>* tags, int tag, int value)
+{
+	tags->append(tag);
+	return value > 100;
+}
+
+void TestQtSignalTools::testPriorityDispatch()
+{
+	CallbackTester sender;
+	QList<int> tags;
+	int initialBindingCount = QtSignalForwarder::sharedProxyStatistics().signalBindingCount;
+
+	// bindings are invoked in order of decreasing priority, and in
+	// connection order for equal priorities
+	int priorities[] = {1, 10, 5, 5};
+	for (int i=0; i < 4; i++) {
+		QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+		  function<void()>(bind(recordTag, &tags, i)),
+		  QtSignalForwarder::BindingOptions().priority(priorities[i])));
+	}
+	// the priority list uses a single connection
+	QCOMPARE(sender.receiverCount(SIGNAL(aSignal(int))), 1);
+	QCOMPARE(QtSignalForwarder::sharedProxyStatistics().signalBindingCount, initialBindingCount + 4);
+
+	sender.emitASignal(1);
+	QCOMPARE(tags, QList<int>() << 1 << 2 << 3 << 0);
+	tags.clear();
+
+	// a high-priority binding can stop propagation
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  function<bool(int)>(bind(recordTagAndStop, &tags, 4, _1)),
+	  QtSignalForwarder::BindingOptions(QtSignalForwarder::StopPropagation).priority(20)));
+	sender.emitASignal(200);
+	QCOMPARE(tags, QList<int>() << 4);
+	tags.clear();
+	sender.emitASignal(1);
+	QCOMPARE(tags, QList<int>() << 4 << 1 << 2 << 3 << 0);
+	tags.clear();
+
+	// StopPropagation requires a callback which returns a bool
+	QVERIFY(!QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  function<void()>(bind(recordTag, &tags, 5)), QtSignalForwarder::StopPropagation));
+
+	// single-shot bindings are removed from the list
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  function<void()>(bind(recordTag, &tags, 6)),
+	  QtSignalForwarder::BindingOptions(QtSignalForwarder::SingleShot).priority(15)));
+	sender.emitASignal(1);
+	sender.emitASignal(1);
+	QCOMPARE(tags, QList<int>() << 4 << 6 << 1 << 2 << 3 << 0 << 4 << 1 << 2 << 3 << 0);
+
+	QtSignalForwarder::disconnect(&sender, SIGNAL(aSignal(int)));
+	QCOMPARE(sender.receiverCount(SIGNAL(aSignal(int))), 0);
+	QCOMPARE(QtSignalForwarder::sharedProxyStatistics().signalBindingCount, initialBindingCount);
+}
+
+void TestQtSignalTools::testSampling()
+{
+	CallbackTester sender;
+	CallbackTester everyThird;
+	CallbackTester random;
+	QList<int> prioritizedTags;
+
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  QtCallback(&everyThird, SLOT(addValue(int))), QtSignalForwarder::BindingOptions().sampleEvery(3)));
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  QtCallback(&random, SLOT(addValue(int))), QtSignalForwarder::BindingOptions().sampleRandomly(4)));
+
+	// sampling also applies to bindings in a priority list
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  function<void(int)>(bind(recordTag, &prioritizedTags, _1)),
+	  QtSignalForwarder::BindingOptions().priority(1).sampleEvery(2)));
+
+	const int EMISSION_COUNT = 4000;
+	for (int i=1; i <= EMISSION_COUNT; i++) {
+		sender.emitASignal(i);
+	}
+
+	QCOMPARE(everyThird.values.count(), EMISSION_COUNT / 3);
+	QCOMPARE(everyThird.values.mid(0, 3), QList<int>() << 3 << 6 << 9);
+	QCOMPARE(prioritizedTags.count(), EMISSION_COUNT / 2);
+	QCOMPARE(prioritizedTags.mid(0, 3), QList<int>() << 2 << 4 << 6);
+
+	// the expected count is 1000 with a standard deviation of about 27
+	QVERIFY(random.values.count() > 850);
+	QVERIFY(random.values.count() < 1150);
+
+	// a single-shot binding is removed at its first sampled emission
+	CallbackTester once;
+	QVERIFY(QtSignalForwarder::connect(&sender, SIGNAL(aSignal(int)),
+	  QtCallback(&once, SLOT(addValue(int))), QtSignalForwarder::BindingOptions(QtSignalForwarder::SingleShot).sampleEvery(2)));
+	sender.emitASignal(1);
+	sender.emitASignal(2);
+	sender.emitASignal(3);
+	QCOMPARE(once.values, QList<int>() << 2);
+}
+
 class TestRef
 {
 public:
@@ -538,4 +1188,1451 @@ void TestQtSignalTools::testThread()
 	QVERIFY(t2.wait());
 }
 
-QTEST_MAIN(TestQtSignalTools)
+void TestQtSignalTools::testBoundedQueue()
+{
+	CallbackTester tester;
+
+	// calls are delivered via the event loop, oldest calls
+	// are discarded when the queue is full
+	QtBoundedQueue* queue = new QtBoundedQueue(QtCallback(&tester, SLOT(addValue(int))), 3,
+	  QtBoundedQueue::DropOldest, &tester);
+	QVERIFY(QtSignalForwarder::connect(&tester, SIGNAL(aSignal(int)), queue, queue->adapter()));
+	for (int i=0; i < 5; i++) {
+		tester.emitASignal(i);
+	}
+	QCOMPARE(tester.values, QList<int>());
+	QCOMPARE(queue->pendingCount(), 3);
+	QCOMPARE(queue->droppedCount(), quint64(2));
+	QCoreApplication::processEvents();
+	QCOMPARE(tester.values, QList<int>() << 2 << 3 << 4);
+	QCOMPARE(queue->deliveredCount(), quint64(3));
+	delete queue;
+	tester.values.clear();
+
+	// new calls are discarded when the queue is full
+	queue = new QtBoundedQueue(QtCallback(&tester, SLOT(addValue(int))), 3,
+	  QtBoundedQueue::DropNewest, &tester);
+	QtSignalForwarder::connect(&tester, SIGNAL(aSignal(int)), queue, queue->adapter());
+	for (int i=0; i < 5; i++) {
+		tester.emitASignal(i);
+	}
+	QCoreApplication::processEvents();
+	QCOMPARE(tester.values, QList<int>() << 0 << 1 << 2);
+	QCOMPARE(queue->droppedCount(), quint64(2));
+	delete queue;
+	tester.values.clear();
+
+	// pending calls with the same key are replaced
+	queue = new QtBoundedQueue(QtCallback(&tester, SLOT(addValue(int))), 3,
+	  QtBoundedQueue::KeepLatestPerKey, &tester);
+	QtSignalForwarder::connect(&tester, SIGNAL(aSignal(int)), queue, queue->adapter());
+	tester.emitASignal(1);
+	tester.emitASignal(2);
+	tester.emitASignal(1);
+	tester.emitASignal(2);
+	tester.emitASignal(3);
+	QCOMPARE(queue->pendingCount(), 3);
+	QCoreApplication::processEvents();
+	QCOMPARE(tester.values, QList<int>() << 1 << 2 << 3);
+	QCOMPARE(queue->droppedCount(), quint64(2));
+	delete queue;
+	tester.values.clear();
+
+	// when the producer is on the queue's thread, a blocking
+	// queue delivers pending calls instead of waiting
+	queue = new QtBoundedQueue(QtCallback(&tester, SLOT(addValue(int))), 2,
+	  QtBoundedQueue::BlockProducer, &tester);
+	QtSignalForwarder::connect(&tester, SIGNAL(aSignal(int)), queue, queue->adapter());
+	for (int i=0; i < 3; i++) {
+		tester.emitASignal(i);
+	}
+	QCOMPARE(tester.values, QList<int>() << 0 << 1);
+	QCoreApplication::processEvents();
+	QCOMPARE(tester.values, QList<int>() << 0 << 1 << 2);
+	QCOMPARE(queue->droppedCount(), quint64(0));
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+void recordBatch(QList<int>* batchSizes, QList<int>* numbers, QStringList* texts,
+	const QVector<int>& numberBatch, const QVector<QString>& textBatch)
+{
+	batchSizes->append(numberBatch.count());
+	Q_FOREACH(int number, numberBatch) {
+		numbers->append(number);
+	}
+	Q_FOREACH(const QString& text, textBatch) {
+		texts->append(text);
+	}
+}
+#endif
+
+void TestQtSignalTools::testSignalBatcher()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	QList<int> batchSizes;
+	QList<int> numbers;
+	QStringList texts;
+	CallbackTester tester;
+	QtSignalBatcher batcher(function<void(const QVector<int>&, const QVector<QString>&)>(
+	  bind(recordBatch, &batchSizes, &numbers, &texts, _1, _2)));
+	QVERIFY(batcher.isValid());
+	QVERIFY(QtSignalForwarder::connect(&tester, SIGNAL(pairSignal(int,QString)), &batcher, batcher.adapter()));
+
+	// emissions are delivered together when control
+	// returns to the event loop
+	tester.emitPairSignal(1, "a");
+	tester.emitPairSignal(2, "b");
+	tester.emitPairSignal(3, "c");
+	QCOMPARE(batcher.pendingCount(), 3);
+	QVERIFY(batchSizes.isEmpty());
+	QCoreApplication::processEvents();
+	QCOMPARE(batchSizes, QList<int>() << 3);
+	QCOMPARE(numbers, QList<int>() << 1 << 2 << 3);
+	QCOMPARE(texts, QStringList() << "a" << "b" << "c");
+
+	// a batch is delivered immediately when it reaches the maximum count
+	batcher.setMaxCount(2);
+	tester.emitPairSignal(4, "d");
+	tester.emitPairSignal(5, "e");
+	tester.emitPairSignal(6, "f");
+	QCOMPARE(batchSizes, QList<int>() << 3 << 2);
+	QCOMPARE(batcher.pendingCount(), 1);
+	QCoreApplication::processEvents();
+	QCOMPARE(batchSizes, QList<int>() << 3 << 2 << 1);
+	QCOMPARE(numbers, QList<int>() << 1 << 2 << 3 << 4 << 5 << 6);
+
+	// with a maximum delay, batches span turns of the event loop
+	batcher.setMaxCount(0);
+	batcher.setMaxDelay(20);
+	tester.emitPairSignal(7, "g");
+	QTest::qWait(100);
+	QCOMPARE(batchSizes, QList<int>() << 3 << 2 << 1 << 1);
+	QCOMPARE(batcher.batchCount(), quint64(4));
+
+	// the callback must take a QVector for each argument
+	QtSignalBatcher invalidBatcher(QtCallback(&tester, SLOT(addValue(int))));
+	QVERIFY(!invalidBatcher.isValid());
+#else
+	SKIP_TEST("QVector<T> types are only registered automatically with Qt 5");
+#endif
+}
+
+void TestQtSignalTools::testSignalRecorder()
+{
+	QString path = QDir::temp().filePath("TestQtSignalTools.qstlog");
+	CallbackTester sender;
+	{
+		// channels can be added before and after the log is opened
+		QtSignalRecorder recorder;
+		QVERIFY(recorder.record(&sender, SIGNAL(aSignal(int))));
+		QVERIFY(recorder.open(path));
+		QVERIFY(recorder.record(&sender, SIGNAL(stringSignal(QString)), "strings"));
+
+		sender.emitASignal(1);
+		sender.emitStringSignal("two");
+		sender.emitASignal(3);
+		QCOMPARE(recorder.emissionCount(), qint64(3));
+		QCOMPARE(recorder.droppedCount(), qint64(0));
+
+		// emissions after the log is closed are not recorded
+		recorder.close();
+		sender.emitASignal(4);
+	}
+	// the bindings are removed when the recorder is destroyed
+	QCOMPARE(sender.receiverCount(SIGNAL(aSignal(int))), 0);
+	QCOMPARE(sender.receiverCount(SIGNAL(stringSignal(QString))), 0);
+
+	QtSignalReplayer replayer;
+	QVERIFY(replayer.open(path));
+	QCOMPARE(replayer.channels(), QList<QByteArray>() << "CallbackTester::aSignal(int)" << "strings");
+	QCOMPARE(replayer.paramTypes("strings"), QList<QByteArray>() << "QString");
+	QCOMPARE(replayer.emissionCount(), qint64(3));
+
+	CallbackTester receiver;
+	QStringList texts;
+	QVERIFY(replayer.bind("CallbackTester::aSignal(int)", QtCallback(&receiver, SLOT(addValue(int)))));
+	QVERIFY(!replayer.bind("strings", QtCallback(&receiver, SLOT(addValue(int)))));
+	QVERIFY(replayer.bind("strings", function<void(const QString&)>(bind(recordText, &texts, _1))));
+
+	QCOMPARE(replayer.replay(), qint64(3));
+	QCOMPARE(receiver.values, QList<int>() << 1 << 3);
+	QCOMPARE(texts, QStringList() << "two");
+
+	QCOMPARE(replayer.replay(QtSignalReplayer::RecordedPacing), qint64(3));
+	QCOMPARE(receiver.values, QList<int>() << 1 << 3 << 1 << 3);
+
+	replayer.close();
+	QFile::remove(path);
+}
+
+void TestQtSignalTools::testArgumentCodec()
+{
+	QVERIFY(QtArgumentCodec::hasFastPath(QMetaType::Int));
+	QVERIFY(QtArgumentCodec::hasFastPath(QMetaType::QString));
+	QVERIFY(QtArgumentCodec::hasFastPath(QMetaType::QStringList));
+	QVERIFY(!QtArgumentCodec::hasFastPath(QMetaType::QPoint));
+
+	QList<int> typeIds;
+	typeIds << QMetaType::Int << QMetaType::Double << QMetaType::QString << QMetaType::QByteArray
+	  << QMetaType::QStringList << QMetaType::QPoint;
+	QtArgumentCodec codec(typeIds);
+	QCOMPARE(codec.typeIds(), typeIds);
+	QVERIFY(!codec.isDirect());
+
+	// encode several tuples into one buffer, including
+	// null and empty values
+	QByteArray buffer;
+	for (int i=0; i < 3; i++) {
+		int number = i;
+		double real = i / 2.0;
+		QString text = i == 0 ? QString() : QString(i, QLatin1Char('x'));
+		QByteArray bytes = i == 1 ? QByteArray("") : QByteArray(i, 'y');
+		QStringList list;
+		for (int k=0; k < i; k++) {
+			list << QString::number(k);
+		}
+		QPoint point(i, -i);
+		QGenericArgument args[] = { Q_ARG(int, number), Q_ARG(double, real), Q_ARG(QString, text),
+		  Q_ARG(QByteArray, bytes), Q_ARG(QStringList, list), Q_ARG(QPoint, point) };
+		QVERIFY(codec.encode(&buffer, args, 6));
+	}
+
+	int offset = 0;
+	int tupleCount = 0;
+	QVariant values[6];
+	while (offset < buffer.size()) {
+		QVERIFY(codec.decode(buffer.constData(), buffer.size(), &offset, values));
+		int i = tupleCount++;
+		QCOMPARE(values[0].value<int>(), i);
+		QCOMPARE(values[1].value<double>(), i / 2.0);
+		QCOMPARE(values[2].value<QString>().isNull(), i == 0);
+		QCOMPARE(values[2].value<QString>().length(), i);
+		QCOMPARE(values[3].value<QByteArray>().isNull(), i == 0);
+		QCOMPARE(values[3].value<QByteArray>().size(), i);
+		QCOMPARE(values[4].value<QStringList>().count(), i);
+		QCOMPARE(values[5].value<QPoint>(), QPoint(i, -i));
+	}
+	QCOMPARE(tupleCount, 3);
+	QCOMPARE(offset, buffer.size());
+
+	// truncated data is rejected
+	offset = 0;
+	QVERIFY(!codec.decode(buffer.constData(), 10, &offset, values));
+	QCOMPARE(offset, 0);
+
+	// single values
+	QByteArray valueBuffer;
+	QString text("value");
+	QVERIFY(QtArgumentCodec::encodeValue(&valueBuffer, QMetaType::QString, &text));
+	QString decodedText;
+	offset = 0;
+	QVERIFY(QtArgumentCodec::decodeValue(valueBuffer.constData(), valueBuffer.size(), &offset,
+	  QMetaType::QString, &decodedText));
+	QCOMPARE(decodedText, text);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	QVERIFY(QtArgumentCodec::hasFastPath(qMetaTypeId<QVector<double> >()));
+	QVector<double> samples;
+	samples << 1.5 << 2.5 << -3;
+	valueBuffer.clear();
+	QVERIFY(QtArgumentCodec::encodeValue(&valueBuffer, qMetaTypeId<QVector<double> >(), &samples));
+	QVector<double> decodedSamples;
+	offset = 0;
+	QVERIFY(QtArgumentCodec::decodeValue(valueBuffer.constData(), valueBuffer.size(), &offset,
+	  qMetaTypeId<QVector<double> >(), &decodedSamples));
+	QCOMPARE(decodedSamples, samples);
+#endif
+}
+
+void TestQtSignalTools::testRemoteSignal()
+{
+	const QString serverName("TestQtSignalTools-remote");
+
+	CallbackTester target;
+	QStringList texts;
+	QtRemoteSignalReceiver receiver;
+	receiver.bind("values", QtCallback(&target, SLOT(addValue(int))));
+	receiver.bind("strings", function<void(const QString&)>(bind(recordText, &texts, _1)));
+	QVERIFY(receiver.listen(serverName));
+
+	// signals can be forwarded before and after connecting
+	CallbackTester source;
+	QtRemoteSignalSender sender;
+	QVERIFY(sender.forward(&source, SIGNAL(aSignal(int)), "values"));
+	QVERIFY(sender.connectToServer(serverName));
+	QVERIFY(sender.forward(&source, SIGNAL(stringSignal(QString)), "strings"));
+
+	// shared memory is used once the receiver has attached to the ring
+	for (int i=0; i < 500 && !sender.isRingAttached(); i++) {
+		QTest::qWait(10);
+	}
+	QVERIFY(sender.isRingAttached());
+
+	// emissions are sent together when control returns to the event loop,
+	// and the large payload is passed through shared memory
+	QString largeText(20000, QLatin1Char('x'));
+	source.emitASignal(1);
+	source.emitStringSignal("small");
+	source.emitStringSignal(largeText);
+	source.emitASignal(2);
+	QCOMPARE(sender.sentCount(), qint64(0));
+
+	for (int i=0; i < 500 && receiver.receivedCount() < 4; i++) {
+		QTest::qWait(10);
+	}
+	QCOMPARE(sender.sentCount(), qint64(4));
+	QCOMPARE(sender.sharedPayloadCount(), qint64(1));
+	QCOMPARE(sender.droppedCount(), qint64(0));
+	QCOMPARE(receiver.receivedCount(), qint64(4));
+	QCOMPARE(target.values, QList<int>() << 1 << 2);
+	QCOMPARE(texts, QStringList() << "small" << largeText);
+
+	// emissions are dropped once the sender disconnects
+	sender.disconnectFromServer();
+	source.emitASignal(3);
+	QCOMPARE(sender.droppedCount(), qint64(1));
+
+	// a sender which disconnects before the receiver has attached
+	// to its ring sends large payloads over the socket
+	QtRemoteSignalSender shortLivedSender;
+	QVERIFY(shortLivedSender.forward(&source, SIGNAL(stringSignal(QString)), "strings"));
+	QVERIFY(shortLivedSender.connectToServer(serverName));
+	source.emitStringSignal(largeText);
+	shortLivedSender.disconnectFromServer();
+	QCOMPARE(shortLivedSender.sentCount(), qint64(1));
+	QCOMPARE(shortLivedSender.sharedPayloadCount(), qint64(0));
+
+	for (int i=0; i < 500 && receiver.receivedCount() < 5; i++) {
+		QTest::qWait(10);
+	}
+	QCOMPARE(receiver.receivedCount(), qint64(5));
+	QCOMPARE(texts.last(), largeText);
+
+	// frames which arrive while a callback runs a nested event loop,
+	// and the disconnection which follows them, are handled once the
+	// callback returns, and each frame is delivered once
+	QList<int> nestedValues;
+	QtRemoteSignalSender nestedSender;
+	receiver.bind("nested", function<void(int)>(bind(recordValueInEventLoop, &nestedValues, &nestedSender, _1)));
+	QVERIFY(nestedSender.forward(&source, SIGNAL(aSignal(int)), "nested"));
+	QVERIFY(nestedSender.connectToServer(serverName));
+	source.emitASignal(1);
+	nestedSender.flush();
+	source.emitASignal(2);
+	source.emitASignal(3);
+
+	for (int i=0; i < 500 && receiver.receivedCount() < 8; i++) {
+		QTest::qWait(10);
+	}
+	QTest::qWait(50);
+	QCOMPARE(receiver.receivedCount(), qint64(8));
+	QCOMPARE(nestedValues, QList<int>() << 1 << 2 << 3);
+}
+
+#ifdef QST_COMPILER_SUPPORTS_COROUTINES
+DetachedTask awaitNoArgSignal(CallbackTester* tester, QList<bool>* results)
+{
+	results->append(co_await qtSignal(tester, SIGNAL(noArgSignal())));
+}
+
+DetachedTask awaitInContext(CallbackTester* sender, QObject* context, QList<QThread*>* threads)
+{
+	if (co_await qtSignal(sender, SIGNAL(noArgSignal()), context)) {
+		threads->append(QThread::currentThread());
+	}
+}
+
+DetachedTask sleepThenAddValue(CallbackTester* tester, int value)
+{
+	if (co_await qtSleep(10, tester)) {
+		tester->addValue(value);
+	}
+}
+#endif
+
+void TestQtSignalTools::testCoroutineAwait()
+{
+#ifdef QST_COMPILER_SUPPORTS_COROUTINES
+	QList<bool> results;
+
+	// coroutine is resumed when the signal is emitted
+	CallbackTester tester;
+	awaitNoArgSignal(&tester, &results);
+	QCOMPARE(results, QList<bool>());
+	tester.emitNoArgSignal();
+	QCOMPARE(results, QList<bool>() << true);
+
+	// coroutine is resumed with a false result if the
+	// sender is destroyed
+	CallbackTester* sender = new CallbackTester;
+	awaitNoArgSignal(sender, &results);
+	delete sender;
+	QCOMPARE(results, QList<bool>() << true << false);
+
+	// coroutine is resumed after a delay
+	QEventLoop loop;
+	connect(&tester, SIGNAL(valuesChanged()), &loop, SLOT(quit()));
+	sleepThenAddValue(&tester, 42);
+	loop.exec();
+	QCOMPARE(tester.values, QList<int>() << 42);
+
+	// with a context object, the coroutine is resumed on the context's
+	// thread when the signal is emitted from another thread
+	QList<QThread*> threads;
+	CallbackTester remoteSender;
+	awaitInContext(&remoteSender, &tester, &threads);
+	std::thread emitter([&remoteSender] { remoteSender.emitNoArgSignal(); });
+	emitter.join();
+	for (int i=0; i < 100 && threads.isEmpty(); i++) {
+		QTest::qWait(10);
+	}
+	QCOMPARE(threads, QList<QThread*>() << QThread::currentThread());
+#else
+	SKIP_TEST("Compiler does not support C++20 coroutines");
+#endif
+}
+
+void TestQtSignalTools::testSignalTrace()
+{
+	QtSignalTrace::clear();
+	QtSignalTrace::setEnabled(true);
+
+	CallbackTester tester;
+	QtSignalForwarder::connect(&tester, SIGNAL(aSignal(int)), QtCallback(&tester, SLOT(addValue(int))));
+	tester.emitASignal(42);
+
+	// events are not recorded once tracing is disabled
+	QtSignalTrace::setEnabled(false);
+	tester.emitASignal(43);
+	QCOMPARE(tester.values, QList<int>() << 42 << 43);
+
+	QByteArray trace = QtSignalTrace::exportChromeTrace();
+	QCOMPARE(trace.count("\"name\":\"CallbackTester::aSignal(int)\""), 1);
+	QCOMPARE(trace.count("\"name\":\"CallbackTester::addValue(int)\""), 1);
+	QCOMPARE(trace.count("\"ph\":\"B\""), 2);
+	QCOMPARE(trace.count("\"ph\":\"E\""), 2);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	QJsonParseError error;
+	QJsonDocument document = QJsonDocument::fromJson(trace, &error);
+	QCOMPARE(error.error, QJsonParseError::NoError);
+	QVERIFY(document.object().value("traceEvents").isArray());
+#endif
+
+	QtSignalTrace::clear();
+	QVERIFY(!QtSignalTrace::exportChromeTrace().contains("aSignal"));
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+void busyWait(int ms)
+{
+	QElapsedTimer timer;
+	timer.start();
+	while (timer.elapsed() < ms) {
+	}
+}
+#endif
+
+void TestQtSignalTools::testSignalWatchdog()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+	int defaultSampleInterval = QtSignalWatchdog::sampleInterval();
+	QCOMPARE(defaultSampleInterval, 32);
+
+	QtSignalWatchdog::clear();
+	QtSignalWatchdog::setGuiThreadThreshold(5000);
+	QtSignalWatchdog::setSampleInterval(1);
+	QtSignalWatchdog::setEnabled(true);
+
+	CallbackTester tester;
+	QtSignalForwarder::connect(&tester, SIGNAL(aSignal(int)), QtCallback(&tester, SLOT(addValue(int))));
+	QtSignalForwarder::connect(&tester, SIGNAL(noArgSignal()), function<void()>(bind(busyWait, 10)));
+
+	// only the slow callback is reported
+	tester.emitASignal(42);
+	tester.emitNoArgSignal();
+
+	QList<QtSignalWatchdog::Report> reports = QtSignalWatchdog::takeReports();
+	QCOMPARE(reports.count(), 1);
+	QCOMPARE(reports.at(0).senderClass, QByteArray("CallbackTester"));
+	QCOMPARE(reports.at(0).name, QByteArray("noArgSignal()"));
+	QVERIFY(reports.at(0).durationUsecs >= 10000);
+	QVERIFY(reports.at(0).guiThread);
+	QVERIFY(QtSignalWatchdog::reports().isEmpty());
+
+	// the oldest reports are discarded once the limit is reached
+	QtSignalWatchdog::setMaxReports(2);
+	for (int i=0; i < 3; i++) {
+		tester.emitNoArgSignal();
+	}
+	QCOMPARE(QtSignalWatchdog::reports().count(), 2);
+	QCOMPARE(QtSignalWatchdog::droppedReportCount(), 1ULL);
+
+	// with a sample interval of N, one in every N consecutive
+	// dispatches in a thread is timed
+	QtSignalWatchdog::clear();
+	QtSignalWatchdog::setSampleInterval(4);
+	for (int i=0; i < 4; i++) {
+		tester.emitNoArgSignal();
+	}
+	QCOMPARE(QtSignalWatchdog::reports().count(), 1);
+	QtSignalWatchdog::setSampleInterval(1);
+
+	// callbacks are not timed once the watchdog is disabled
+	QtSignalWatchdog::clear();
+	QtSignalWatchdog::setEnabled(false);
+	tester.emitNoArgSignal();
+	QVERIFY(QtSignalWatchdog::reports().isEmpty());
+
+	QtSignalWatchdog::setMaxReports(100);
+	QtSignalWatchdog::setGuiThreadThreshold(8000);
+	QtSignalWatchdog::setSampleInterval(defaultSampleInterval);
+#else
+	SKIP_TEST("QtSignalWatchdog requires Qt 4.8");
+#endif
+}
+
+void TestQtSignalTools::testEmitAllocations()
+{
+	CallbackTester tester;
+	CallCounter counter;
+	QObject object;
+
+	QtSignalForwarder::connect(&tester, SIGNAL(aSignal(int)), intFunc);
+	QtSignalForwarder::connect(&tester, SIGNAL(noArgSignal()), incrementFunc(counter));
+	QtSignalForwarder::connect(&tester, SIGNAL(noArgSignal()),
+	  function<bool()>(safe_bind(&object, &QObject::signalsBlocked)));
+
+	// warm up any lazily initialized state
+	tester.emitASignal(1);
+	tester.emitNoArgSignal();
+
+	// emitting a signal to function object bindings
+	// should not allocate
+	AllocationCounter::start();
+	for (int i=0; i < 100; i++) {
+		tester.emitASignal(i);
+		tester.emitNoArgSignal();
+	}
+	AllocationCounter::stop();
+
+	QCOMPARE(AllocationCounter::allocationCount(), 0LL);
+	QCOMPARE(counter.count, 101);
+}
+
+// returns the number of allocations made by calling @p func
+// divided by @p operationCount
+double allocationsPerOp(const function<void()>& func, int operationCount)
+{
+	AllocationCounter::start();
+	func();
+	AllocationCounter::stop();
+	return AllocationCounter::allocationCount() / static_cast<double>(operationCount);
+}
+
+void connectSenders(const QVector<CallbackTester*>& senders)
+{
+	Q_FOREACH(CallbackTester* sender, senders) {
+		QtSignalForwarder::connect(sender, SIGNAL(aSignal(int)), intFunc);
+	}
+}
+
+void emitSenders(const QVector<CallbackTester*>& senders)
+{
+	Q_FOREACH(CallbackTester* sender, senders) {
+		sender->emitASignal(1);
+	}
+}
+
+void disconnectSenders(const QVector<CallbackTester*>& senders)
+{
+	Q_FOREACH(CallbackTester* sender, senders) {
+		QtSignalForwarder::disconnect(sender, SIGNAL(aSignal(int)));
+	}
+}
+
+void invokeCallbacks(const QtCallback& callback, int count)
+{
+	int value = 1;
+	for (int i=0; i < count; i++) {
+		callback.invokeWithArgs(Q_ARG(int, value));
+	}
+}
+
+void bindCallbacks(CallbackTester* receiver, int count)
+{
+	for (int i=0; i < count; i++) {
+		QtCallback callback(receiver, SLOT(addValueIfSenderIsSelf(CallbackTester*,int)));
+		callback.bind(QVariant::fromValue(receiver));
+	}
+}
+
+void callSafeBinders(QObject* object, int count)
+{
+	function<bool()> isBlocked(safe_bind(object, &QObject::signalsBlocked));
+	for (int i=0; i < count; i++) {
+		isBlocked();
+	}
+}
+
+void TestQtSignalTools::testAllocationPerf()
+{
+	SKIP_BENCHMARK();
+
+	if (!AllocationCounter::countsMalloc()) {
+		qDebug() << "Note: Only allocations made with operator new are counted on this platform";
+	}
+
+	QList<int> bindingCounts;
+	bindingCounts << 1000 << 100 * 1000 << 1000 * 1000;
+
+	Q_FOREACH(int bindingCount, bindingCounts) {
+		QVector<CallbackTester*> senders;
+		senders.reserve(bindingCount);
+		for (int i=0; i < bindingCount; i++) {
+			senders << new CallbackTester;
+		}
+
+		AllocationCounter::start();
+		connectSenders(senders);
+		AllocationCounter::stop();
+		double connectAllocs = AllocationCounter::allocationCount() / static_cast<double>(bindingCount);
+		double bytesPerBinding = AllocationCounter::netBytes() / static_cast<double>(bindingCount);
+
+		double emitAllocs = allocationsPerOp(bind(emitSenders, senders), bindingCount);
+		double disconnectAllocs = allocationsPerOp(bind(disconnectSenders, senders), bindingCount);
+
+		qDebug() << "bindings" << bindingCount
+		  << "bytes per binding" << bytesPerBinding
+		  << "allocations per connect()" << connectAllocs
+		  << "emit" << emitAllocs
+		  << "disconnect()" << disconnectAllocs;
+
+		qDeleteAll(senders);
+	}
+
+	const int callCount = 10000;
+	CallbackTester receiver;
+	QtCallback callback(&receiver, SLOT(addValueIfSenderIsSelf(CallbackTester*,int)));
+	callback.bind(QVariant::fromValue(&receiver));
+
+	qDebug() << "allocations per QtCallback construct + bind()"
+	  << allocationsPerOp(bind(bindCallbacks, &receiver, callCount), callCount);
+	qDebug() << "allocations per QtCallback invoke()"
+	  << allocationsPerOp(bind(invokeCallbacks, callback, callCount), callCount);
+	qDebug() << "allocations per safe_bind() call"
+	  << allocationsPerOp(bind(callSafeBinders, &receiver, callCount), callCount);
+}
+
+qint64 nsecsElapsed(const QElapsedTimer* clock)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+	return clock->nsecsElapsed();
+#else
+	Q_UNUSED(clock);
+	return 0;
+#endif
+}
+
+void MessageTester::emitMessage(const QByteArray& payload)
+{
+	emit message(nsecsElapsed(m_clock), payload);
+}
+
+void MessageTester::receive(qint64 sentAt, const QByteArray& payload)
+{
+	Q_UNUSED(payload);
+
+	latencies << nsecsElapsed(m_clock) - sentAt;
+	if (receivedCount.fetchAndAddRelease(1) + 1 == m_expectedCount) {
+		thread()->quit();
+	}
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+int atomicLoad(const QAtomicInt& value)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+	return value.loadAcquire();
+#else
+	return value;
+#endif
+}
+
+enum ProducerMode
+{
+	// emit a signal bound to a QtCallback via QtSignalForwarder
+	EmitToBinding,
+	// invoke a QtCallback directly
+	InvokeCallback
+};
+
+// producers wait when more than this many messages are queued, so that
+// latency measures the cost of dispatch rather than the length of an
+// ever-growing queue
+const int MAX_MESSAGES_IN_FLIGHT = 10000;
+
+void produceMessages(MessageTester* receiver, ProducerMode mode, int count, int payloadSize,
+  QAtomicInt* sentCount)
+{
+	MessageTester sender(receiver->clock());
+	QtCallback callback(receiver, SLOT(receive(qint64,QByteArray)));
+	if (mode == EmitToBinding) {
+		QtSignalForwarder::connect(&sender, SIGNAL(message(qint64,QByteArray)), callback);
+	}
+
+	for (int i=0; i < count; i++) {
+		while (atomicLoad(*sentCount) - atomicLoad(receiver->receivedCount) > MAX_MESSAGES_IN_FLIGHT) {
+			QThread::yieldCurrentThread();
+		}
+		sentCount->fetchAndAddRelaxed(1);
+
+		QByteArray payload(payloadSize, 'x');
+		if (mode == EmitToBinding) {
+			sender.emitMessage(payload);
+		} else {
+			qint64 sentAt = nsecsElapsed(receiver->clock());
+			callback.invokeWithArgs(Q_ARG(qint64, sentAt), Q_ARG(QByteArray, payload));
+		}
+	}
+}
+
+// returns the value at @p fraction through a sorted list
+qint64 percentile(const QVector<qint64>& sortedValues, double fraction)
+{
+	if (sortedValues.isEmpty()) {
+		return 0;
+	}
+	int index = qMin(static_cast<int>(sortedValues.count() * fraction), sortedValues.count() - 1);
+	return sortedValues.at(index);
+}
+#endif
+
+void TestQtSignalTools::testCrossThreadPerf()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+	SKIP_BENCHMARK();
+
+	const int MESSAGES_PER_PRODUCER = 100 * 1000;
+
+	QList<ProducerMode> modes;
+	modes << EmitToBinding << InvokeCallback;
+	QList<int> producerCounts;
+	producerCounts << 1 << 2 << 4 << 8;
+	QList<int> payloadSizes;
+	payloadSizes << 0 << 64 << 4096;
+
+	QElapsedTimer clock;
+	clock.start();
+
+	Q_FOREACH(ProducerMode mode, modes) {
+		Q_FOREACH(int producerCount, producerCounts) {
+			Q_FOREACH(int payloadSize, payloadSizes) {
+				int messageCount = producerCount * MESSAGES_PER_PRODUCER;
+
+				// the receiver runs on a separate consumer thread, which exits
+				// once all messages have been received
+				QThread consumer;
+				MessageTester receiver(&clock, messageCount);
+				receiver.latencies.reserve(messageCount);
+				receiver.moveToThread(&consumer);
+				consumer.start();
+
+				QAtomicInt sentCount;
+				QList<TestThread*> producers;
+				for (int i=0; i < producerCount; i++) {
+					producers << new TestThread(bind(produceMessages, &receiver, mode, MESSAGES_PER_PRODUCER,
+					  payloadSize, &sentCount), 0);
+				}
+
+				qint64 startTime = clock.nsecsElapsed();
+				Q_FOREACH(TestThread* producer, producers) {
+					producer->start();
+				}
+				Q_FOREACH(TestThread* producer, producers) {
+					producer->wait();
+				}
+				QVERIFY(consumer.wait());
+				qint64 elapsed = clock.nsecsElapsed() - startTime;
+				qDeleteAll(producers);
+
+				QCOMPARE(receiver.latencies.count(), messageCount);
+				std::sort(receiver.latencies.begin(), receiver.latencies.end());
+
+				qDebug() << (mode == EmitToBinding ? "signal binding" : "QtCallback")
+				  << "producers" << producerCount
+				  << "payload bytes" << payloadSize
+				  << "msgs/sec" << qRound64(messageCount / (elapsed / (1000.0 * 1000 * 1000)))
+				  << "latency us p50" << percentile(receiver.latencies, 0.5) / 1000.0
+				  << "p99" << percentile(receiver.latencies, 0.99) / 1000.0
+				  << "p99.9" << percentile(receiver.latencies, 0.999) / 1000.0;
+			}
+		}
+	}
+#endif
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+// sends an Enter, MouseButtonPress and Leave event to each widget
+// and returns the mean time per event in nanoseconds
+double sendEventStorm(const QVector<QWidget*>& widgets)
+{
+	QEvent enterEvent(QEvent::Enter);
+	QEvent leaveEvent(QEvent::Leave);
+	QMouseEvent pressEvent(QEvent::MouseButtonPress, QPoint(0,0), Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+
+	QElapsedTimer timer;
+	timer.start();
+	Q_FOREACH(QWidget* widget, widgets) {
+		QCoreApplication::sendEvent(widget, &enterEvent);
+		QCoreApplication::sendEvent(widget, &pressEvent);
+		QCoreApplication::sendEvent(widget, &leaveEvent);
+	}
+	return timer.nsecsElapsed() / (widgets.count() * 3.0);
+}
+
+// returns the mean time in nanoseconds to connect the Enter, Leave and
+// MouseButtonPress events for each widget to @p callback
+double connectWidgetEvents(const QVector<QWidget*>& widgets, const function<void()>& callback)
+{
+	QElapsedTimer timer;
+	timer.start();
+	Q_FOREACH(QWidget* widget, widgets) {
+		QtSignalForwarder::connect(widget, QEvent::Enter, callback);
+		QtSignalForwarder::connect(widget, QEvent::Leave, callback);
+		QtSignalForwarder::connect(widget, QEvent::MouseButtonPress, callback);
+	}
+	return timer.nsecsElapsed() / (widgets.count() * 3.0);
+}
+
+// creates @p count child widgets of @p parent
+QVector<QWidget*> createWidgets(QWidget* parent, int count)
+{
+	QVector<QWidget*> widgets;
+	widgets.reserve(count);
+	for (int i=0; i < count; i++) {
+		widgets << new QWidget(parent);
+	}
+	return widgets;
+}
+
+// returns the time in nanoseconds to delete @p widget
+qint64 timeDelete(QWidget* widget)
+{
+	QElapsedTimer timer;
+	timer.start();
+	delete widget;
+	return timer.nsecsElapsed();
+}
+#endif
+
+void TestQtSignalTools::testEventBindingPerf()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+	SKIP_BENCHMARK();
+
+	QList<int> widgetCounts;
+	widgetCounts << 1000 << 10 * 1000 << 100 * 1000;
+
+	int initialBindingCount = QtSignalForwarder::sharedProxyStatistics().eventBindingCount;
+
+	Q_FOREACH(int widgetCount, widgetCounts) {
+		QWidget* root = new QWidget;
+		QVector<QWidget*> widgets = createWidgets(root, widgetCount);
+
+		CallCounter counter;
+		function<void()> callback(bind(&CallCounter::increment, &counter));
+
+		double unboundEventNs = sendEventStorm(widgets);
+		double bindNs = connectWidgetEvents(widgets, callback);
+		double boundEventNs = sendEventStorm(widgets);
+		QCOMPARE(counter.count, widgetCount * 3);
+
+		QElapsedTimer timer;
+		timer.start();
+		Q_FOREACH(QWidget* widget, widgets) {
+			QtSignalForwarder::disconnect(widget, QEvent::Enter);
+			QtSignalForwarder::disconnect(widget, QEvent::Leave);
+			QtSignalForwarder::disconnect(widget, QEvent::MouseButtonPress);
+		}
+		double unbindNs = timer.nsecsElapsed() / (widgetCount * 3.0);
+		QCOMPARE(QtSignalForwarder::sharedProxyStatistics().eventBindingCount, initialBindingCount);
+
+		// compare the cost of destroying widgets with and
+		// without bindings
+		qint64 unboundTeardownNs = timeDelete(root);
+		root = new QWidget;
+		connectWidgetEvents(createWidgets(root, widgetCount), callback);
+		qint64 boundTeardownNs = timeDelete(root);
+		QCOMPARE(QtSignalForwarder::sharedProxyStatistics().eventBindingCount, initialBindingCount);
+
+		qDebug() << "widgets" << widgetCount
+		  << "ns per event unbound" << unboundEventNs
+		  << "bound" << boundEventNs
+		  << "filter overhead" << boundEventNs - unboundEventNs
+		  << "ns per bind" << bindNs
+		  << "unbind" << unbindNs
+		  << "teardown ms unbound" << unboundTeardownNs / (1000.0 * 1000)
+		  << "bound" << boundTeardownNs / (1000.0 * 1000);
+	}
+#endif
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+// small deterministic random number generator, so that each
+// thread's sequence of operations is repeatable
+class ChurnRandom
+{
+	public:
+		explicit ChurnRandom(quint32 seed)
+			: m_state(seed ? seed : 1)
+		{}
+
+		// returns a number in the range [0, bound)
+		int next(int bound)
+		{
+			m_state ^= m_state << 13;
+			m_state ^= m_state >> 17;
+			m_state ^= m_state << 5;
+			return static_cast<int>(m_state % static_cast<quint32>(bound));
+		}
+
+	private:
+		quint32 m_state;
+};
+
+enum ChurnTarget
+{
+	ChurnValueSignal,
+	ChurnNoArgSignal,
+	ChurnEnterEvent,
+	ChurnTargetCount
+};
+
+// a binding in the model of the bindings which
+// the proxies are expected to hold
+struct ChurnBinding
+{
+	ChurnBinding(int _sender = -1, ChurnTarget _target = ChurnValueSignal, int _context = -1)
+		: sender(_sender)
+		, target(_target)
+		, context(_context)
+	{}
+
+	int sender;
+	ChurnTarget target;
+	// index of the context object or -1
+	int context;
+};
+
+struct ChurnSample
+{
+	ChurnSample(int _operation = 0, int _bindingCount = 0, qint64 _estimatedBytes = 0)
+		: operation(_operation)
+		, bindingCount(_bindingCount)
+		, estimatedBytes(_estimatedBytes)
+	{}
+
+	int operation;
+	int bindingCount;
+	qint64 estimatedBytes;
+};
+
+struct ChurnResult
+{
+	ChurnResult()
+		: elapsedNs(0)
+		, errorCount(0)
+		, remainingBindings(-1)
+	{}
+
+	qint64 elapsedNs;
+
+	// duration of each operation in nanoseconds
+	QVector<qint64> operationTimes;
+
+	// binding table sizes over the course of the run
+	QList<ChurnSample> samples;
+
+	int errorCount;
+	QString firstError;
+
+	// number of bindings left in the thread's shared proxies
+	// after all objects have been deleted
+	int remainingBindings;
+};
+
+void addChurnError(ChurnResult* result, const QString& error)
+{
+	if (result->errorCount == 0) {
+		result->firstError = error;
+	}
+	++result->errorCount;
+}
+
+// removes the bindings from @p model which match @p predicate
+template <class Predicate>
+void removeChurnBindings(QList<ChurnBinding>& model, Predicate predicate)
+{
+	for (int i = model.count() - 1; i >= 0; i--) {
+		if (predicate(model.at(i))) {
+			model.removeAt(i);
+		}
+	}
+}
+
+bool churnBindingMatches(const ChurnBinding& binding, int sender, ChurnTarget target)
+{
+	return binding.sender == sender && binding.target == target;
+}
+
+bool churnBindingUsesObject(const ChurnBinding& binding, int object)
+{
+	return binding.sender == object || binding.context == object;
+}
+
+// randomly connects, disconnects, emits and deletes objects using the shared
+// proxies for the current thread and checks the results against a model
+// of the expected bindings.
+//
+// Objects [0, senderCount) are senders, which may also be used as contexts, the
+// remainder are plain contexts.
+void runChurn(quint32 seed, int senderCount, int operationCount, ChurnResult* result)
+{
+	ChurnRandom random(seed);
+
+	QVector<QObject*> objects;
+	for (int i=0; i < senderCount; i++) {
+		objects << new CallbackTester;
+	}
+	int contextCount = senderCount / 4 + 1;
+	for (int i=0; i < contextCount; i++) {
+		objects << new QObject;
+	}
+
+	CallCounter counter;
+	function<void()> callback(bind(&CallCounter::increment, &counter));
+	function<void(int)> valueCallback(bind(&CallCounter::increment, &counter));
+
+	QList<ChurnBinding> model;
+	int sampleInterval = qMax(operationCount / 20, 1);
+	result->operationTimes.reserve(operationCount);
+
+	QElapsedTimer timer;
+	timer.start();
+
+	for (int i=0; i < operationCount; i++) {
+		int senderIndex = random.next(senderCount);
+		CallbackTester* sender = static_cast<CallbackTester*>(objects.at(senderIndex));
+		ChurnTarget target = static_cast<ChurnTarget>(random.next(ChurnTargetCount));
+		int operation = random.next(100);
+
+		qint64 startTime = timer.nsecsElapsed();
+		if (operation < 30) {
+			int context = -1;
+			if (target != ChurnEnterEvent && random.next(3) == 0) {
+				context = random.next(objects.count());
+			}
+			QObject* contextObject = context >= 0 ? objects.at(context) : 0;
+
+			bool connected = false;
+			switch (target) {
+			case ChurnValueSignal:
+				connected = QtSignalForwarder::connect(sender, SIGNAL(aSignal(int)), contextObject, valueCallback);
+				break;
+			case ChurnNoArgSignal:
+				connected = QtSignalForwarder::connect(sender, SIGNAL(noArgSignal()), contextObject, callback);
+				break;
+			default:
+				connected = QtSignalForwarder::connect(sender, QEvent::Enter, callback);
+				break;
+			}
+			if (connected) {
+				model << ChurnBinding(senderIndex, target, context);
+			} else {
+				addChurnError(result, QString("Failed to connect at operation %1").arg(i));
+			}
+		} else if (operation < 42) {
+			switch (target) {
+			case ChurnValueSignal:
+				QtSignalForwarder::disconnect(sender, SIGNAL(aSignal(int)));
+				break;
+			case ChurnNoArgSignal:
+				QtSignalForwarder::disconnect(sender, SIGNAL(noArgSignal()));
+				break;
+			default:
+				QtSignalForwarder::disconnect(sender, QEvent::Enter);
+				break;
+			}
+			removeChurnBindings(model, bind(churnBindingMatches, _1, senderIndex, target));
+		} else if (operation < 46) {
+			// delete a sender or context and replace it
+			int objectIndex = random.next(objects.count());
+			delete objects.at(objectIndex);
+			objects[objectIndex] = objectIndex < senderCount ? new CallbackTester : new QObject;
+			removeChurnBindings(model, bind(churnBindingUsesObject, _1, objectIndex));
+		} else {
+			int callCount = counter.count;
+			switch (target) {
+			case ChurnValueSignal:
+				sender->emitASignal(i);
+				break;
+			case ChurnNoArgSignal:
+				sender->emitNoArgSignal();
+				break;
+			default:
+				{
+					QEvent enterEvent(QEvent::Enter);
+					QCoreApplication::sendEvent(sender, &enterEvent);
+				}
+				break;
+			}
+			callCount = counter.count - callCount;
+
+			int expectedCallCount = 0;
+			Q_FOREACH(const ChurnBinding& binding, model) {
+				if (churnBindingMatches(binding, senderIndex, target)) {
+					++expectedCallCount;
+				}
+			}
+			if (callCount != expectedCallCount) {
+				addChurnError(result, QString("Expected %1 calls at operation %2, got %3")
+				  .arg(expectedCallCount).arg(i).arg(callCount));
+			}
+		}
+		result->operationTimes << timer.nsecsElapsed() - startTime;
+
+		if (i % sampleInterval == 0) {
+			QtSignalForwarder::Statistics stats = QtSignalForwarder::sharedProxyStatistics();
+			int bindingCount = stats.signalBindingCount + stats.eventBindingCount;
+			if (bindingCount != model.count()) {
+				addChurnError(result, QString("Expected %1 bindings at operation %2, found %3")
+				  .arg(model.count()).arg(i).arg(bindingCount));
+			}
+			result->samples << ChurnSample(i, bindingCount, stats.estimatedBytes);
+		}
+	}
+
+	// exclude the time taken to collect samples
+	qint64 totalOperationTime = 0;
+	Q_FOREACH(qint64 operationTime, result->operationTimes) {
+		totalOperationTime += operationTime;
+	}
+	result->elapsedNs = totalOperationTime;
+
+	qDeleteAll(objects);
+
+	QtSignalForwarder::Statistics stats = QtSignalForwarder::sharedProxyStatistics();
+	result->remainingBindings = stats.signalBindingCount + stats.eventBindingCount;
+	if (stats.senderCount != 0 || stats.eventFilterCount != 0) {
+		addChurnError(result, QString("%1 senders and %2 event filters remain after deleting all objects")
+		  .arg(stats.senderCount).arg(stats.eventFilterCount));
+	}
+}
+
+// runs runChurn() in @p threadCount threads, each with
+// its own shared proxies
+QList<ChurnResult> runChurnThreads(int threadCount, int senderCount, int operationCount)
+{
+	QVector<ChurnResult> results(threadCount);
+	QList<TestThread*> threads;
+	for (int i=0; i < threadCount; i++) {
+		threads << new TestThread(bind(runChurn, i + 1, senderCount, operationCount, &results[i]), 0);
+	}
+	Q_FOREACH(TestThread* thread, threads) {
+		thread->start();
+	}
+	Q_FOREACH(TestThread* thread, threads) {
+		thread->wait();
+	}
+	qDeleteAll(threads);
+	return results.toList();
+}
+#endif
+
+void TestQtSignalTools::testBindingChurn()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+	Q_FOREACH(const ChurnResult& result, runChurnThreads(2, 16, 5000)) {
+		if (result.errorCount > 0) {
+			qWarning() << result.errorCount << "errors, first error:" << result.firstError;
+		}
+		QCOMPARE(result.errorCount, 0);
+		QCOMPARE(result.remainingBindings, 0);
+	}
+#endif
+}
+
+void TestQtSignalTools::testBindingChurnPerf()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+	SKIP_BENCHMARK();
+
+	const int OPERATIONS_PER_THREAD = 200 * 1000;
+
+	QList<int> threadCounts;
+	threadCounts << 1 << 2 << 4 << 8;
+	QList<int> senderCounts;
+	senderCounts << 64 << 1024;
+
+	Q_FOREACH(int senderCount, senderCounts) {
+		Q_FOREACH(int threadCount, threadCounts) {
+			QList<ChurnResult> results = runChurnThreads(threadCount, senderCount, OPERATIONS_PER_THREAD);
+
+			QVector<qint64> operationTimes;
+			qint64 maxElapsedNs = 0;
+			Q_FOREACH(const ChurnResult& result, results) {
+				QCOMPARE(result.errorCount, 0);
+				QCOMPARE(result.remainingBindings, 0);
+				operationTimes += result.operationTimes;
+				maxElapsedNs = qMax(maxElapsedNs, result.elapsedNs);
+			}
+			std::sort(operationTimes.begin(), operationTimes.end());
+
+			qDebug() << "senders" << senderCount
+			  << "threads" << threadCount
+			  << "ops/sec" << qRound64(operationTimes.count() / (maxElapsedNs / (1000.0 * 1000 * 1000)))
+			  << "latency us p50" << percentile(operationTimes, 0.5) / 1000.0
+			  << "p99" << percentile(operationTimes, 0.99) / 1000.0
+			  << "p99.9" << percentile(operationTimes, 0.999) / 1000.0
+			  << "max" << operationTimes.last() / 1000.0;
+
+			Q_FOREACH(const ChurnSample& sample, results.first().samples) {
+				qDebug() << "  operation" << sample.operation
+				  << "bindings" << sample.bindingCount
+				  << "estimated bytes" << sample.estimatedBytes;
+			}
+		}
+	}
+#endif
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+// returns the signature of the take() slot or emitted() signal
+// with @p argCount arguments of type @p typeName, prefixed with
+// the code used by the SLOT() or SIGNAL() macros
+QByteArray benchmarkSignature(char code, const char* name, const char* typeName, int argCount)
+{
+	QByteArray signature;
+	signature += code;
+	signature += name;
+	signature += '(';
+	for (int i=0; i < argCount; i++) {
+		if (i > 0) {
+			signature += ',';
+		}
+		signature += typeName;
+	}
+	signature += ')';
+	return signature;
+}
+
+void waitForCalls(const InvokeBenchmarkTester* receiver, int count)
+{
+	while (atomicLoad(receiver->callCount) < count) {
+		QThread::yieldCurrentThread();
+	}
+}
+
+// returns the mean time in nanoseconds to invoke a QtCallback for a slot on @p receiver
+// with @p boundCount of its @p argCount arguments bound in advance.  If the receiver
+// lives on another thread, this includes the time until all calls are delivered.
+template <class T>
+double timeCallbackInvoke(InvokeBenchmarkTester* receiver, const char* typeName, const T& value,
+  int argCount, int boundCount, int callCount)
+{
+	QtCallback callback(receiver, benchmarkSignature('1', "take", typeName, argCount).constData());
+	for (int i=0; i < boundCount; i++) {
+		callback.bind(value);
+	}
+	QGenericArgument args[10];
+	for (int i=0; i < argCount - boundCount; i++) {
+		args[i] = QGenericArgument(typeName, &value);
+	}
+
+	int expectedCount = atomicLoad(receiver->callCount) + callCount;
+	QElapsedTimer timer;
+	timer.start();
+	for (int i=0; i < callCount; i++) {
+		callback.invokeWithArgs(args[0], args[1], args[2], args[3], args[4], args[5], args[6],
+		  args[7], args[8], args[9]);
+	}
+	waitForCalls(receiver, expectedCount);
+	return timer.nsecsElapsed() / static_cast<double>(callCount);
+}
+
+// returns the mean time in nanoseconds to emit a signal connected
+// to a slot on @p receiver with a native Qt connection
+template <class T>
+double timeSignalEmit(InvokeBenchmarkTester* sender, InvokeBenchmarkTester* receiver, const char* typeName,
+  const T& value, int argCount, int callCount)
+{
+	QByteArray signal = benchmarkSignature('2', "emitted", typeName, argCount);
+	QByteArray slot = benchmarkSignature('1', "take", typeName, argCount);
+	QObject::connect(sender, signal.constData(), receiver, slot.constData());
+
+	int expectedCount = atomicLoad(receiver->callCount) + callCount;
+	QElapsedTimer timer;
+	timer.start();
+	for (int i=0; i < callCount; i++) {
+		sender->emitSignal(argCount, value);
+	}
+	waitForCalls(receiver, expectedCount);
+	double result = timer.nsecsElapsed() / static_cast<double>(callCount);
+
+	QObject::disconnect(sender, signal.constData(), receiver, slot.constData());
+	return result;
+}
+
+template <class T>
+double timeDirectCall(InvokeBenchmarkTester* receiver, const T& value, int argCount, int callCount)
+{
+	QElapsedTimer timer;
+	timer.start();
+	for (int i=0; i < callCount; i++) {
+		receiver->callDirect(argCount, value);
+	}
+	return timer.nsecsElapsed() / static_cast<double>(callCount);
+}
+
+void printInvokeResult(const char* method, const char* typeName, int argCount, int boundCount,
+  const char* thread, double nsPerCall)
+{
+	qDebug("%s,%s,%d,%d,%s,%.1f", method, typeName, argCount, boundCount, thread, nsPerCall);
+}
+
+// prints the cost per call of each invocation method for slots with 0-6
+// arguments of type T, with receivers on the same and on another thread
+template <class T>
+void runInvokeBenchmarks(const char* typeName, const T& value)
+{
+	const int SAME_THREAD_CALL_COUNT = 100 * 1000;
+	const int CROSS_THREAD_CALL_COUNT = 20 * 1000;
+	const int MAX_BOUND_COUNT = 5;
+
+	InvokeBenchmarkTester sender;
+	InvokeBenchmarkTester localReceiver;
+
+	QThread receiverThread;
+	InvokeBenchmarkTester remoteReceiver;
+	remoteReceiver.moveToThread(&receiverThread);
+	receiverThread.start();
+
+	for (int argCount = 0; argCount <= 6; argCount++) {
+		printInvokeResult("direct", typeName, argCount, 0, "same",
+		  timeDirectCall(&localReceiver, value, argCount, SAME_THREAD_CALL_COUNT));
+		printInvokeResult("signal", typeName, argCount, 0, "same",
+		  timeSignalEmit(&sender, &localReceiver, typeName, value, argCount, SAME_THREAD_CALL_COUNT));
+		printInvokeResult("signal", typeName, argCount, 0, "cross",
+		  timeSignalEmit(&sender, &remoteReceiver, typeName, value, argCount, CROSS_THREAD_CALL_COUNT));
+
+		for (int boundCount = 0; boundCount <= qMin(argCount, MAX_BOUND_COUNT); boundCount++) {
+			printInvokeResult("QtCallback", typeName, argCount, boundCount, "same",
+			  timeCallbackInvoke(&localReceiver, typeName, value, argCount, boundCount, SAME_THREAD_CALL_COUNT));
+			printInvokeResult("QtCallback", typeName, argCount, boundCount, "cross",
+			  timeCallbackInvoke(&remoteReceiver, typeName, value, argCount, boundCount, CROSS_THREAD_CALL_COUNT));
+		}
+	}
+
+	receiverThread.quit();
+	receiverThread.wait();
+}
+#endif
+
+void TestQtSignalTools::testInvokePerf()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+	SKIP_BENCHMARK();
+
+	qRegisterMetaType<BenchValue>("BenchValue");
+
+	BenchValue benchValue;
+	benchValue.id = 1;
+	benchValue.weight = 1.5;
+	benchValue.label = "label";
+
+	// output is in CSV format for plotting
+	qDebug("method,type,args,bound,thread,ns_per_call");
+	runInvokeBenchmarks("int", 42);
+	runInvokeBenchmarks("QString", QString("Hello World"));
+	runInvokeBenchmarks("BenchValue", benchValue);
+#endif
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+void countCall(int* count)
+{
+	++*count;
+}
+
+// returns the mean time in nanoseconds to emit a signal
+// with one trivial binding, taking the fastest of several runs
+double timeWatchdogEmits(CallbackTester* tester, int emitCount)
+{
+	const int RUN_COUNT = 5;
+	qint64 best = -1;
+	for (int run=0; run < RUN_COUNT; run++) {
+		QElapsedTimer timer;
+		timer.start();
+		for (int i=0; i < emitCount; i++) {
+			tester->emitNoArgSignal();
+		}
+		qint64 elapsed = timer.nsecsElapsed();
+		if (best < 0 || elapsed < best) {
+			best = elapsed;
+		}
+	}
+	return double(best) / emitCount;
+}
+#endif
+
+void TestQtSignalTools::testWatchdogPerf()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(4,8,0)
+	SKIP_BENCHMARK();
+
+	const int EMIT_COUNT = 200000;
+
+	// the callback does almost nothing, so the overhead reported
+	// is the worst case relative to the cost of a dispatch
+	int callCount = 0;
+	CallbackTester tester;
+	QtSignalForwarder::connect(&tester, SIGNAL(noArgSignal()), function<void()>(bind(countCall, &callCount)));
+
+	int defaultSampleInterval = QtSignalWatchdog::sampleInterval();
+	bool wasEnabled = QtSignalWatchdog::isEnabled();
+
+	QtSignalWatchdog::setEnabled(false);
+	timeWatchdogEmits(&tester, EMIT_COUNT);
+	double baseline = timeWatchdogEmits(&tester, EMIT_COUNT);
+
+	// output is in CSV format for plotting
+	qDebug("watchdog,sample_interval,ns_per_emit,overhead_percent");
+	qDebug("disabled,,%.1f,0.0", baseline);
+
+	int intervals[] = { 1, 8, defaultSampleInterval, 128 };
+	for (size_t i=0; i < sizeof(intervals) / sizeof(int); i++) {
+		QtSignalWatchdog::setSampleInterval(intervals[i]);
+		QtSignalWatchdog::setEnabled(true);
+		double nsPerEmit = timeWatchdogEmits(&tester, EMIT_COUNT);
+		QtSignalWatchdog::setEnabled(false);
+		qDebug("enabled,%d,%.1f,%.1f", intervals[i], nsPerEmit, (nsPerEmit - baseline) * 100 / baseline);
+	}
+
+	QtSignalWatchdog::setSampleInterval(defaultSampleInterval);
+	QtSignalWatchdog::setEnabled(wasEnabled);
+	QtSignalWatchdog::clear();
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	// run without a display by default, so that the tests and
+	// widget benchmarks can run on headless machines
+	if (qgetenv("QT_QPA_PLATFORM").isEmpty()) {
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+	}
+	QApplication app(argc, argv);
+	TestQtSignalTools test;
+	return QTest::qExec(&test, argc, argv);
+}
@@ -22,16 +22,41 @@ class TestQtSignalTools : public QObject
 		void testUnbind();
 		void testDelayedCall();
 		void testSafeBinder();
+		void testSafeBindAll();
+		void testCallbackScope();
 		void testBindingCount();
+		void testBindingStatistics();
 		void testManySenders();
 		void testProxyBindingLimits();
 		void testConnectWithSender();
+		void testPassSender();
+		void testBindingStages();
+		void testSignalJoins();
+		void testSingleShot();
+		void testPriorityDispatch();
+		void testSampling();
 		void testContextDestroyed();
 		void testContextDestroyedEqualsSender();
 		void testContextDestroyedShared();
 		void testThread();
+		void testBindingChurn();
+		void testBoundedQueue();
+		void testSignalBatcher();
+		void testSignalRecorder();
+		void testArgumentCodec();
+		void testRemoteSignal();
+		void testCoroutineAwait();
+		void testSignalTrace();
+		void testSignalWatchdog();
+		void testEmitAllocations();
 
 		void testConnectPerf();
+		void testAllocationPerf();
+		void testCrossThreadPerf();
+		void testEventBindingPerf();
+		void testBindingChurnPerf();
+		void testInvokePerf();
+		void testWatchdogPerf();
 };
 
 class CallbackTester : public QObject
@@ -56,6 +81,11 @@ class CallbackTester : public QObject
 			emit stringSignal(arg);
 		}
 
+		void emitPairSignal(int number, const QString& text)
+		{
+			emit pairSignal(number, text);
+		}
+
 		// expose protected QObject::receivers() method
 		int receiverCount(const char* signal) const
 		{
@@ -81,4 +111,176 @@ class CallbackTester : public QObject
 		void noArgSignal();
 		void valuesChanged();
 		void stringSignal(const QString& arg);
+		void pairSignal(int number, const QString& text);
+};
+
+class QElapsedTimer;
+
+/** Sends and receives timestamped messages for the
+ * cross-thread benchmarks.
+ */
+class MessageTester : public QObject
+{
+	Q_OBJECT
+
+	public:
+		MessageTester(const QElapsedTimer* clock, int expectedCount = 0)
+			: m_clock(clock)
+			, m_expectedCount(expectedCount)
+		{}
+
+		const QElapsedTimer* clock() const
+		{
+			return m_clock;
+		}
+
+		void emitMessage(const QByteArray& payload);
+
+		// time in nanoseconds between each message being sent
+		// and received
+		QVector<qint64> latencies;
+		QAtomicInt receivedCount;
+
+	public Q_SLOTS:
+		/** Records the latency of a message.  Once the expected number of
+		 * messages have been received, the current thread's event loop is stopped.
+		 */
+		void receive(qint64 sentAt, const QByteArray& payload);
+
+	Q_SIGNALS:
+		void message(qint64 sentAt, const QByteArray& payload);
+
+	private:
+		const QElapsedTimer* m_clock;
+		int m_expectedCount;
+};
+
+/** A custom value type used in the QtCallback
+ * invocation benchmarks.
+ */
+struct BenchValue
+{
+	BenchValue()
+		: id(0)
+		, weight(0)
+	{}
+
+	int id;
+	double weight;
+	QString label;
+};
+Q_DECLARE_METATYPE(BenchValue)
+
+/** Receiver with slots taking 0-6 arguments of each of the
+ * value types used in the QtCallback invocation benchmarks, and
+ * signals with matching signatures.
+ */
+class InvokeBenchmarkTester : public QObject
+{
+	Q_OBJECT
+
+	public:
+		QAtomicInt callCount;
+
+		/** Calls the take() overload with @p argCount arguments
+		 * directly.
+		 */
+		template <class T>
+		void callDirect(int argCount, const T& value)
+		{
+			switch (argCount) {
+			case 0:
+				take();
+				break;
+			case 1:
+				take(value);
+				break;
+			case 2:
+				take(value, value);
+				break;
+			case 3:
+				take(value, value, value);
+				break;
+			case 4:
+				take(value, value, value, value);
+				break;
+			case 5:
+				take(value, value, value, value, value);
+				break;
+			case 6:
+				take(value, value, value, value, value, value);
+				break;
+			}
+		}
+
+		/** Emits the emitted() signal with @p argCount arguments. */
+		template <class T>
+		void emitSignal(int argCount, const T& value)
+		{
+			switch (argCount) {
+			case 0:
+				emit emitted();
+				break;
+			case 1:
+				emit emitted(value);
+				break;
+			case 2:
+				emit emitted(value, value);
+				break;
+			case 3:
+				emit emitted(value, value, value);
+				break;
+			case 4:
+				emit emitted(value, value, value, value);
+				break;
+			case 5:
+				emit emitted(value, value, value, value, value);
+				break;
+			case 6:
+				emit emitted(value, value, value, value, value, value);
+				break;
+			}
+		}
+
+	public Q_SLOTS:
+		void take() { callCount.fetchAndAddRelaxed(1); }
+		void take(int) { callCount.fetchAndAddRelaxed(1); }
+		void take(int, int) { callCount.fetchAndAddRelaxed(1); }
+		void take(int, int, int) { callCount.fetchAndAddRelaxed(1); }
+		void take(int, int, int, int) { callCount.fetchAndAddRelaxed(1); }
+		void take(int, int, int, int, int) { callCount.fetchAndAddRelaxed(1); }
+		void take(int, int, int, int, int, int) { callCount.fetchAndAddRelaxed(1); }
+		void take(const QString&) { callCount.fetchAndAddRelaxed(1); }
+		void take(const QString&, const QString&) { callCount.fetchAndAddRelaxed(1); }
+		void take(const QString&, const QString&, const QString&) { callCount.fetchAndAddRelaxed(1); }
+		void take(const QString&, const QString&, const QString&, const QString&) { callCount.fetchAndAddRelaxed(1); }
+		void take(const QString&, const QString&, const QString&, const QString&, const QString&) { callCount.fetchAndAddRelaxed(1); }
+		void take(const QString&, const QString&, const QString&, const QString&, const QString&, const QString&) { callCount.fetchAndAddRelaxed(1); }
+		void take(const BenchValue&) { callCount.fetchAndAddRelaxed(1); }
+		void take(const BenchValue&, const BenchValue&) { callCount.fetchAndAddRelaxed(1); }
+		void take(const BenchValue&, const BenchValue&, const BenchValue&) { callCount.fetchAndAddRelaxed(1); }
+		void take(const BenchValue&, const BenchValue&, const BenchValue&, const BenchValue&) { callCount.fetchAndAddRelaxed(1); }
+		void take(const BenchValue&, const BenchValue&, const BenchValue&, const BenchValue&, const BenchValue&) { callCount.fetchAndAddRelaxed(1); }
+		void take(const BenchValue&, const BenchValue&, const BenchValue&, const BenchValue&, const BenchValue&, const BenchValue&) { callCount.fetchAndAddRelaxed(1); }
+
+	Q_SIGNALS:
+		void emitted();
+		void emitted(int);
+		void emitted(int, int);
+		void emitted(int, int, int);
+		void emitted(int, int, int, int);
+		void emitted(int, int, int, int, int);
+		void emitted(int, int, int, int, int, int);
+		void emitted(const QString&);
+		void emitted(const QString&, const QString&);
+		void emitted(const QString&, const QString&, const QString&);
+		void emitted(const QString&, const QString&, const QString&, const QString&);
+		void emitted(const QString&, const QString&, const QString&, const QString&, const QString&);
+		void emitted(const QString&, const QString&, const QString&, const QString&, const QString&, const QString&);
+		void emitted(const BenchValue&);
+		void emitted(const BenchValue&, const BenchValue&);
+		void emitted(const BenchValue&, const BenchValue&, const BenchValue&);
+		void emitted(const BenchValue&, const BenchValue&, const BenchValue&, const BenchValue&);
+		void emitted(const BenchValue&, const BenchValue&, const BenchValue&, const BenchValue&, const BenchValue&);
+		void emitted(const BenchValue&, const BenchValue&, const BenchValue&, const BenchValue&, const BenchValue&, const BenchValue&);
 };
@@ -1,6 +1,15 @@
-QT += testlib
+QT += testlib widgets network
 
 CONFIG -= app_bundle
+
+# build the tests as C++20 where qmake supports it, so that the coroutine
+# adaptors in QtSignalAwaiter.h are tested.  GCC 10 needs coroutines
+# to be enabled explicitly.
+greaterThan(QT_MAJOR_VERSION, 4) {
+	CONFIG += c++2a
+	*-g++*:equals(QMAKE_GCC_MAJOR_VERSION, 10): QMAKE_CXXFLAGS += -fcoroutines
+}
+
 INCLUDEPATH += ..
-HEADERS += ../QtCallback.h ../QtSignalForwarder.cpp TestQtSignalTools.h
-SOURCES += ../QtCallback.cpp ../QtSignalForwarder.cpp TestQtSignalTools.cpp
+HEADERS += AllocationCounter.h ../QtArgumentCodec.h ../QtBoundedQueue.h ../QtCallback.h ../QtCallbackScope.h ../QtRemoteSignal.h ../QtSignalForwarder.cpp ../QtSignalAwaiter.h ../QtSignalBatcher.h ../QtSignalRecorder.h ../QtSignalToolsPrivate.h ../QtSignalTrace.h ../QtSignalWatchdog.h TestQtSignalTools.h
+SOURCES += AllocationCounter.cpp ../QtArgumentCodec.cpp ../QtBoundedQueue.cpp ../QtCallback.cpp ../QtRemoteSignal.cpp ../QtSignalBatcher.cpp ../QtSignalForwarder.cpp ../QtSignalRecorder.cpp ../QtSignalTrace.cpp ../QtSignalWatchdog.cpp TestQtSignalTools.cpp